@@ -239,12 +239,28 @@ uint8_t buffer[BUFFER_SIZE];    // a multiple of the block size
  *
  * If the entire request is only a single byte long then the number of arguments
  * is assumed to be zero.
+ *
+ * The DigestBytes and DigestChunks requests take an optional second argument, a
+ * single byte containing the DigestAlgorithm to use (SHA512 if omitted).
  */
 struct Argument {
     uint8_t* pointer;
     size_t length;
 };
 Argument* arguments = 0;
+uint8_t numberOfArguments = 0;
+
+
+/*
+ * This function returns the digest algorithm passed as the optional one byte argument
+ * at the specified index of the current request. If the argument is missing the
+ * default algorithm (SHA512) is returned.
+ */
+DigestAlgorithm digestAlgorithm(size_t index) {
+    if (index >= numberOfArguments) return DigestSHA512;
+    if (arguments[index].length != 1) return BadAlgorithm;
+    return (DigestAlgorithm) arguments[index].pointer[0];
+}
 
 
 // Forward Declarations
@@ -343,14 +359,39 @@ void requestCallback(uint16_t connectionHandle) {
             bool success = false;
             const uint8_t* bytes = arguments[0].pointer;
             const size_t size = arguments[0].length;
-            const uint8_t* digest = hsm->digestBytes(bytes, size);
+            DigestAlgorithm algorithm = digestAlgorithm(1);
+            const uint8_t* digest = hsm->digestBytes(bytes, size, algorithm);
             if (digest) {
-                const char* encoded = Codex::encode(digest, DIG_SIZE);
+                const size_t length = hsm->digestSize(algorithm);
+                const char* encoded = Codex::encode(digest, length);
                 Serial.print("Bytes Digest: ");
                 Serial.println(encoded);
                 delete [] encoded;
                 success = true;
-                writeResult(digest, DIG_SIZE);
+                writeResult(digest, length);
+                delete [] digest;
+            }
+            if (!success) writeError();
+            Serial.println(success ? "Succeeded" : "Failed");
+            Serial.println("");
+            break;
+        }
+
+        case DigestChunks: {
+            Serial.println("Digest Chunks");
+            bool success = false;
+            const uint8_t* bytes = arguments[0].pointer;
+            const size_t size = arguments[0].length;
+            DigestAlgorithm algorithm = digestAlgorithm(1);
+            const uint8_t* digest = hsm->digestChunks(bytes, size, BLOCK_SIZE, algorithm);
+            if (digest) {
+                const size_t length = hsm->digestSize(algorithm);
+                const char* encoded = Codex::encode(digest, length);
+                Serial.print("Chunks Digest: ");
+                Serial.println(encoded);
+                delete [] encoded;
+                success = true;
+                writeResult(digest, length);
                 delete [] digest;
             }
             if (!success) writeError();
@@ -464,7 +505,7 @@ RequestType readRequest() {
         Serial.println(bytesRead);
     } else {
         // It's a full request so parse it
-        uint8_t numberOfArguments = bleuart.read();
+        numberOfArguments = bleuart.read();
         Serial.print("Number of arguments: ");
         Serial.println(numberOfArguments);
         size_t bytesRead = bleuart.read(buffer, BLOCK_SIZE);
@@ -73,6 +73,7 @@ AES192 aes192;
 AES256 aes256;
 
 byte buffer[16];
+byte blocks[7 * 16];
 
 void testCipher(BlockCipher *cipher, const struct TestVector *test)
 {
@@ -95,6 +96,41 @@ void testCipher(BlockCipher *cipher, const struct TestVector *test)
         Serial.println("Failed");
 }
 
+void testBlocks(BlockCipher *cipher, const struct TestVector *test)
+{
+    byte plaintext[7 * 16];
+    byte expected[7 * 16];
+    int posn;
+    bool ok;
+
+    crypto_feed_watchdog();
+    Serial.print(test->name);
+    Serial.print(" Encrypt Blocks ... ");
+    cipher->setKey(test->key, cipher->keySize());
+
+    // Give every block a different plaintext so that swapped lanes or
+    // reordered blocks are detected.  Block 0 is the test vector itself.
+    for (posn = 0; posn < 7; ++posn) {
+        memcpy(plaintext + posn * 16, test->plaintext, 16);
+        plaintext[posn * 16] ^= posn;
+        plaintext[posn * 16 + 15] ^= posn << 4;
+        cipher->encryptBlock(expected + posn * 16, plaintext + posn * 16);
+    }
+    cipher->encryptBlocks(blocks, plaintext, 7);
+    ok = memcmp(blocks, test->ciphertext, 16) == 0 &&
+         memcmp(blocks, expected, sizeof(blocks)) == 0;
+    Serial.println(ok ? "Passed" : "Failed");
+
+    Serial.print(test->name);
+    Serial.print(" Decrypt Blocks ... ");
+    for (posn = 0; posn < 7; ++posn)
+        cipher->decryptBlock(expected + posn * 16, blocks + posn * 16);
+    cipher->decryptBlocks(blocks, blocks, 7);
+    ok = memcmp(blocks, plaintext, sizeof(blocks)) == 0 &&
+         memcmp(blocks, expected, sizeof(blocks)) == 0;
+    Serial.println(ok ? "Passed" : "Failed");
+}
+
 void perfCipher(BlockCipher *cipher, const struct TestVector *test)
 {
     unsigned long start;
@@ -139,6 +175,18 @@ void perfCipher(BlockCipher *cipher, const struct TestVector *test)
     Serial.print((16.0 * 5000.0 * 1000000.0) / elapsed);
     Serial.println(" bytes per second");
 
+    Serial.print(test->name);
+    Serial.print(" Encrypt Blocks ... ");
+    start = micros();
+    for (count = 0; count < 1000; ++count) {
+        cipher->encryptBlocks(blocks, blocks, 7);
+    }
+    elapsed = micros() - start;
+    Serial.print(elapsed / (1000.0 * sizeof(blocks)));
+    Serial.print("us per byte, ");
+    Serial.print((1000.0 * sizeof(blocks) * 1000000.0) / elapsed);
+    Serial.println(" bytes per second");
+
     Serial.println();
 }
 
@@ -161,6 +209,9 @@ void setup()
     testCipher(&aes128, &testVectorAES128);
     testCipher(&aes192, &testVectorAES192);
     testCipher(&aes256, &testVectorAES256);
+    testBlocks(&aes128, &testVectorAES128);
+    testBlocks(&aes192, &testVectorAES192);
+    testBlocks(&aes256, &testVectorAES256);
 
     Serial.println();
 
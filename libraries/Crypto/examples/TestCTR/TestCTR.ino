@@ -162,6 +162,53 @@ void testCipher(Cipher *cipher, const struct TestVector *test)
         Serial.println("Failed");
 }
 
+// Encrypts a long buffer in one call with the counter close to wrapping
+// around and compares it with keystream generated one block at a time.
+void testCounterSize(const struct TestVector *test, size_t counterSize)
+{
+    AES128 aes;
+    byte counter[16];
+    byte block[16];
+    size_t posn, index;
+    bool ok = true;
+
+    Serial.print(test->name);
+    Serial.print(" Counter Size ");
+    Serial.print(counterSize);
+    Serial.print(" ... ");
+
+    memcpy(counter, test->iv, 16);
+    memset(counter + 14, 0xFF, 2);
+    counter[13] = 0xFE;
+    for (posn = 0; posn < sizeof(buffer); ++posn)
+        buffer[posn] = (byte)(posn * 3);
+
+    ctraes128.setKey(test->key, ctraes128.keySize());
+    ctraes128.setIV(counter, 16);
+    ctraes128.setCounterSize(counterSize);
+    ctraes128.encrypt(buffer, buffer, 5);
+    ctraes128.encrypt(buffer + 5, buffer + 5, sizeof(buffer) - 5);
+    ctraes128.setCounterSize(16);
+
+    aes.setKey(test->key, aes.keySize());
+    for (posn = 0; posn < sizeof(buffer); posn += 16) {
+        aes.encryptBlock(block, counter);
+        for (index = 0; index < 16; ++index) {
+            if (buffer[posn + index] != (byte)(block[index] ^ ((posn + index) * 3)))
+                ok = false;
+        }
+        for (index = 16; index > 16 - counterSize; --index) {
+            if (++(counter[index - 1]) != 0)
+                break;
+        }
+    }
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
 void perfCipherEncrypt(const char *name, Cipher *cipher, const struct TestVector *test)
 {
     unsigned long start;
@@ -218,6 +265,10 @@ void setup()
     testCipher(&ctraes128, &testVectorAES128CTR1);
     testCipher(&ctraes128, &testVectorAES128CTR2);
     testCipher(&ctraes128, &testVectorAES128CTR3);
+    testCounterSize(&testVectorAES128CTR3, 1);
+    testCounterSize(&testVectorAES128CTR3, 2);
+    testCounterSize(&testVectorAES128CTR3, 4);
+    testCounterSize(&testVectorAES128CTR3, 16);
 
     Serial.println();
 
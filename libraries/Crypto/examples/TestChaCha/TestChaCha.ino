@@ -222,6 +222,7 @@ TestVector testVector;
 ChaCha chacha;
 
 byte buffer[128];
+byte longBuffer[576];
 
 bool testCipher_N(ChaCha *cipher, const struct TestVector *test, size_t inc)
 {
@@ -301,6 +302,48 @@ void testCipher(ChaCha *cipher, const struct TestVector *test)
         Serial.println("Failed");
 }
 
+void testLongStream(ChaCha *cipher, const struct TestVector *test)
+{
+    static byte const counter[8] = {0xFD, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0};
+    size_t posn, len;
+    bool ok = true;
+
+    memcpy_P(&testVector, test, sizeof(TestVector));
+    test = &testVector;
+
+    Serial.print(test->name);
+    Serial.print(" Long Stream ... ");
+
+    // Encrypt a long run of zeroes that starts part-way into a block,
+    // with a counter that carries into the high word along the way.
+    cipher->setNumRounds(test->rounds);
+    cipher->setKey(test->key, test->keySize);
+    cipher->setIV(test->iv, cipher->ivSize());
+    cipher->setCounter(counter, 8);
+    memset(longBuffer, 0, sizeof(longBuffer));
+    cipher->encrypt(longBuffer, longBuffer, 7);
+    cipher->encrypt(longBuffer + 7, longBuffer + 7, sizeof(longBuffer) - 7);
+
+    // Compare with the keystream that is generated one block at a time.
+    cipher->setKey(test->key, test->keySize);
+    cipher->setIV(test->iv, cipher->ivSize());
+    cipher->setCounter(counter, 8);
+    for (posn = 0; posn < sizeof(longBuffer); posn += 64) {
+        len = sizeof(longBuffer) - posn;
+        if (len > 64)
+            len = 64;
+        memset(buffer, 0, len);
+        cipher->encrypt(buffer, buffer, len);
+        if (memcmp(buffer, longBuffer + posn, len) != 0)
+            ok = false;
+    }
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
 void perfCipherSetKey(ChaCha *cipher, const struct TestVector *test)
 {
     unsigned long start;
@@ -381,11 +424,39 @@ void perfCipherDecrypt(ChaCha *cipher, const struct TestVector *test)
     Serial.println(" bytes per second");
 }
 
+void perfCipherEncryptLong(ChaCha *cipher, const struct TestVector *test)
+{
+    unsigned long start;
+    unsigned long elapsed;
+    int count;
+
+    memcpy_P(&testVector, test, sizeof(TestVector));
+    test = &testVector;
+
+    Serial.print(test->name);
+    Serial.print(" Encrypt Long ... ");
+
+    cipher->setNumRounds(test->rounds);
+    cipher->setKey(test->key, test->keySize);
+    cipher->setIV(test->iv, cipher->ivSize());
+    start = micros();
+    for (count = 0; count < 500; ++count) {
+        cipher->encrypt(longBuffer, longBuffer, sizeof(longBuffer));
+    }
+    elapsed = micros() - start;
+
+    Serial.print(elapsed / (sizeof(longBuffer) * 500.0));
+    Serial.print("us per byte, ");
+    Serial.print((sizeof(longBuffer) * 500.0 * 1000000.0) / elapsed);
+    Serial.println(" bytes per second");
+}
+
 void perfCipher(ChaCha *cipher, const struct TestVector *test)
 {
     perfCipherSetKey(cipher, test);
     perfCipherEncrypt(cipher, test);
     perfCipherDecrypt(cipher, test);
+    perfCipherEncryptLong(cipher, test);
 }
 
 void setup()
@@ -405,6 +476,9 @@ void setup()
     testCipher(&chacha, &testVectorChaCha12_256);
     testCipher(&chacha, &testVectorChaCha8_128);
     testCipher(&chacha, &testVectorChaCha8_256);
+    testLongStream(&chacha, &testVectorChaCha20_256);
+    testLongStream(&chacha, &testVectorChaCha12_128);
+    testLongStream(&chacha, &testVectorChaCha8_256);
 
     Serial.println();
 
@@ -286,6 +286,42 @@ void testCipher(ChaChaPoly *cipher, const struct TestVector *test)
         Serial.println("Failed");
 }
 
+void testOneShot(const struct TestVector *test)
+{
+    uint8_t tag[16];
+    bool ok;
+
+    memcpy_P(&testVector, test, sizeof(TestVector));
+    test = &testVector;
+
+    Serial.print(test->name);
+    Serial.print(" One-Shot ... ");
+
+    // Encrypt the plaintext and check the ciphertext and tag.
+    ChaChaPoly::seal(test->key, test->iv, test->authdata, test->authsize,
+                     test->plaintext, buffer, test->datasize, tag);
+    ok = memcmp(buffer, test->ciphertext, test->datasize) == 0;
+    ok &= memcmp(tag, test->tag, sizeof(tag)) == 0;
+
+    // Decrypt in-place and check the plaintext.
+    ok &= ChaChaPoly::open(test->key, test->iv, test->authdata,
+                           test->authsize, buffer, buffer,
+                           test->datasize, tag);
+    ok &= memcmp(buffer, test->plaintext, test->datasize) == 0;
+
+    // A modified tag must be rejected and the output cleared.
+    tag[5] ^= 0x40;
+    ok &= !ChaChaPoly::open(test->key, test->iv, test->authdata,
+                            test->authsize, test->ciphertext, buffer,
+                            test->datasize, tag);
+    ok &= buffer[0] == 0 && buffer[test->datasize - 1] == 0;
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
 void perfCipherSetKey(ChaChaPoly *cipher, const struct TestVector *test)
 {
     unsigned long start;
@@ -440,6 +476,7 @@ void setup()
     Serial.println("Test Vectors:");
     testCipher(&chachapoly, &testVectorChaChaPoly_1);
     testCipher(&chachapoly, &testVectorChaChaPoly_2);
+    testOneShot(&testVectorChaChaPoly_1);
 
     Serial.println();
 
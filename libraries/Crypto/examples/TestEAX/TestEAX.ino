@@ -345,6 +345,67 @@ void testCipher(AuthenticatedCipher *cipher, const struct TestVector *test)
         Serial.println("Failed");
 }
 
+// Processes a long message in one call and then in odd-sized pieces,
+// re-using the key across messages, and checks that the results agree.
+void testLongMessage(AuthenticatedCipher *cipher, const struct TestVector *test)
+{
+    static uint8_t const sizes[3] = {7, 33, 16};
+    uint8_t tag[16];
+    uint8_t tag2[16];
+    size_t posn, len;
+    bool ok = true;
+
+    memcpy_P(&testVector, test, sizeof(TestVector));
+    test = &testVector;
+
+    Serial.print(test->name);
+    Serial.print(" Long Message ... ");
+
+    for (posn = 0; posn < 100; ++posn)
+        buffer[posn] = (uint8_t)(posn * 5);
+    cipher->clear();
+    cipher->setKey(test->key, 16);
+    cipher->setIV(test->iv, test->ivsize);
+    cipher->addAuthData(test->authdata, test->authsize);
+    cipher->encrypt(buffer, buffer, 100);
+    cipher->computeTag(tag, sizeof(tag));
+
+    for (uint8_t size = 0; size < 3; ++size) {
+        uint8_t inc = sizes[size];
+        cipher->setIV(test->iv, test->ivsize);
+        cipher->addAuthData(test->authdata, test->authsize);
+        for (posn = 0; posn < 100; posn += inc) {
+            len = 100 - posn;
+            if (len > inc)
+                len = inc;
+            cipher->decrypt(buffer + posn, buffer + posn, len);
+        }
+        if (!cipher->checkTag(tag, sizeof(tag)))
+            ok = false;
+        for (posn = 0; posn < 100; ++posn) {
+            if (buffer[posn] != (uint8_t)(posn * 5))
+                ok = false;
+        }
+
+        cipher->setIV(test->iv, test->ivsize);
+        cipher->addAuthData(test->authdata, test->authsize);
+        for (posn = 0; posn < 100; posn += inc) {
+            len = 100 - posn;
+            if (len > inc)
+                len = inc;
+            cipher->encrypt(buffer + posn, buffer + posn, len);
+        }
+        cipher->computeTag(tag2, sizeof(tag2));
+        if (memcmp(tag, tag2, sizeof(tag)) != 0)
+            ok = false;
+    }
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
 void perfCipherSetKey(AuthenticatedCipher *cipher, const struct TestVector *test, const char *cipherName)
 {
     unsigned long start;
@@ -533,6 +594,7 @@ void setup()
     testCipher(eax, &testVectorEAX8);
     testCipher(eax, &testVectorEAX9);
     testCipher(eax, &testVectorEAX10);
+    testLongMessage(eax, &testVectorEAX10);
 
     Serial.println();
 
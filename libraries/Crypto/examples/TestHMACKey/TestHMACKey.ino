@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+This example runs tests on the HMACKey class to verify correct behaviour.
+*/
+
+#include <Crypto.h>
+#include <HMACKey.h>
+#include <SHA256.h>
+#include <SHA512.h>
+#include <BLAKE2s.h>
+#include <BLAKE2b.h>
+#include <SHA3.h>
+#include <string.h>
+
+struct TestHMACVector
+{
+    const char *name;
+    const char *key;
+    const char *data;
+    uint8_t hash[64];
+};
+
+// Test case 2 from RFC 4231.
+static TestHMACVector const testVectorHMAC_SHA256 = {
+    "HMAC-SHA-256 RFC 4231 #2",
+    "Jefe",
+    "what do ya want for nothing?",
+    {0x5B, 0xDC, 0xC1, 0x46, 0xBF, 0x60, 0x75, 0x4E,
+     0x6A, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xC7,
+     0x5A, 0x00, 0x3F, 0x08, 0x9D, 0x27, 0x39, 0x83,
+     0x9D, 0xEC, 0x58, 0xB9, 0x64, 0xEC, 0x38, 0x43}
+};
+static TestHMACVector const testVectorHMAC_SHA512 = {
+    "HMAC-SHA-512 RFC 4231 #2",
+    "Jefe",
+    "what do ya want for nothing?",
+    {0x16, 0x4B, 0x7A, 0x7B, 0xFC, 0xF8, 0x19, 0xE2,
+     0xE3, 0x95, 0xFB, 0xE7, 0x3B, 0x56, 0xE0, 0xA3,
+     0x87, 0xBD, 0x64, 0x22, 0x2E, 0x83, 0x1F, 0xD6,
+     0x10, 0x27, 0x0C, 0xD7, 0xEA, 0x25, 0x05, 0x54,
+     0x97, 0x58, 0xBF, 0x75, 0xC0, 0x5A, 0x99, 0x4A,
+     0x6D, 0x03, 0x4F, 0x65, 0xF8, 0xF0, 0xE6, 0xFD,
+     0xCA, 0xEA, 0xB1, 0xA3, 0x4D, 0x4A, 0x6B, 0x4B,
+     0x63, 0x6E, 0x07, 0x0A, 0x38, 0xBC, 0xE7, 0x37}
+};
+
+HMACKey<SHA256> hmacSHA256;
+HMACKey<SHA512> hmacSHA512;
+HMACKey<BLAKE2s> hmacBLAKE2s;
+HMACKey<BLAKE2b> hmacBLAKE2b;
+HMACKey<SHA3_256> hmacSHA3_256;
+
+SHA256 sha256;
+SHA512 sha512;
+BLAKE2s blake2s;
+BLAKE2b blake2b;
+SHA3_256 sha3_256;
+
+byte key[300];
+byte buffer[300];
+byte expected[64];
+byte actual[64];
+
+// Checks HMACKey against a known answer, authenticating the message
+// twice to make sure that reset() restores the cached key schedule.
+void testVector(HMACKeyCommon *hmac, const struct TestHMACVector *test)
+{
+    size_t size = hmac->hashSize();
+    bool ok = true;
+
+    Serial.print(test->name);
+    Serial.print(" ... ");
+
+    hmac->setKey(test->key, strlen(test->key));
+    for (int count = 0; count < 2; ++count) {
+        hmac->reset();
+        hmac->update(test->data, strlen(test->data));
+        hmac->finalize(actual, size);
+        if (memcmp(actual, test->hash, size) != 0)
+            ok = false;
+    }
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+// Cross-checks HMACKey against Hash::resetHMAC() and Hash::finalizeHMAC()
+// for keys that are shorter than, equal to, and longer than a block.
+void testCrossCheck(const char *name, HMACKeyCommon *hmac, Hash *hash)
+{
+    size_t size = hash->hashSize();
+    size_t block = hash->blockSize();
+    size_t keyLens[6] = {0, 1, size, block, block + 1, 2 * block};
+    bool ok = true;
+
+    crypto_feed_watchdog();
+    Serial.print(name);
+    Serial.print(" cross-check ... ");
+
+    for (uint8_t index = 0; index < 6; ++index) {
+        size_t keyLen = keyLens[index];
+        size_t dataLen = block + index * 7;
+        memset(key, (uint8_t)(keyLen + 1), keyLen);
+        memset(buffer, 0xBA ^ index, dataLen);
+
+        hash->resetHMAC(key, keyLen);
+        hash->update(buffer, dataLen);
+        hash->finalizeHMAC(key, keyLen, expected, size);
+
+        hmac->setKey(key, keyLen);
+        hmac->update(buffer, dataLen);
+        hmac->finalize(actual, size);
+        if (memcmp(expected, actual, size) != 0)
+            ok = false;
+    }
+
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void setup()
+{
+    Serial.begin(9600);
+
+    Serial.println();
+
+    Serial.println("Test Vectors:");
+    testVector(&hmacSHA256, &testVectorHMAC_SHA256);
+    testVector(&hmacSHA512, &testVectorHMAC_SHA512);
+    testCrossCheck("HMAC-SHA-256", &hmacSHA256, &sha256);
+    testCrossCheck("HMAC-SHA-512", &hmacSHA512, &sha512);
+    testCrossCheck("HMAC-BLAKE2s", &hmacBLAKE2s, &blake2s);
+    testCrossCheck("HMAC-BLAKE2b", &hmacBLAKE2b, &blake2b);
+    testCrossCheck("HMAC-SHA3-256", &hmacSHA3_256, &sha3_256);
+}
+
+void loop()
+{
+}
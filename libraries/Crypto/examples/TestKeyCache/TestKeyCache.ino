@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+This example runs tests on the KeyCache class to verify correct behaviour.
+*/
+
+#include <Crypto.h>
+#include <AES.h>
+#include <GCM.h>
+#include <KeyCache.h>
+#include <string.h>
+#include <new>
+
+// AES-256 key and plaintext from the FIPS specification.
+static byte const baseKey[32] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+    0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F
+};
+static byte const plaintext[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+    0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+};
+
+KeyCache<AES256, 2> cache;
+AES256 reference;
+
+byte key1[32];
+byte key2[32];
+byte key3[32];
+
+// Checks that a cached context encrypts the same way as a freshly keyed one.
+bool checkKey(AES256 *cipher, const byte *key)
+{
+    byte expected[16];
+    byte actual[16];
+    if (!cipher)
+        return false;
+    reference.setKey(key, 32);
+    reference.encryptBlock(expected, plaintext);
+    cipher->encryptBlock(actual, plaintext);
+    return memcmp(expected, actual, 16) == 0;
+}
+
+void testKeyCache()
+{
+    AES256 *a, *b, *c;
+    bool ok;
+
+    Serial.print("Acquire ... ");
+    a = cache.acquire(key1, 32);
+    ok = checkKey(a, key1);
+    cache.release(a);
+    b = cache.acquire(key1, 32);
+    ok &= (a == b);
+    cache.release(b);
+    Serial.println(ok ? "Passed" : "Failed");
+
+    Serial.print("Evict Least Recently Used ... ");
+    b = cache.acquire(key2, 32);
+    ok = checkKey(b, key2) && a != b;
+    cache.release(b);
+    c = cache.acquire(key3, 32);
+    ok &= (c == a) && checkKey(c, key3);
+    cache.release(c);
+    c = cache.acquire(key2, 32);
+    ok &= (c == b) && checkKey(c, key2);
+    cache.release(c);
+    Serial.println(ok ? "Passed" : "Failed");
+
+    Serial.print("All In Use ... ");
+    a = cache.acquire(key1, 32);
+    b = cache.acquire(key1, 32);
+    ok = checkKey(a, key1) && checkKey(b, key1) && a != b;
+    ok &= (cache.acquire(key2, 32) == 0);
+    cache.release(a);
+    cache.release(b);
+    Serial.println(ok ? "Passed" : "Failed");
+
+    Serial.print("Invalid Key ... ");
+    ok = (cache.acquire(key1, 31) == 0);
+    a = cache.acquire(key1, 32);
+    ok &= checkKey(a, key1);
+    cache.release(a);
+    Serial.println(ok ? "Passed" : "Failed");
+
+    Serial.print("Clear ... ");
+    cache.clear();
+    a = cache.acquire(key3, 32);
+    ok = checkKey(a, key3);
+    cache.release(a);
+    Serial.println(ok ? "Passed" : "Failed");
+}
+
+// Returns true if "data" contains the bytes of "key" anywhere.
+bool containsKey(const byte *data, size_t size, const byte *key)
+{
+    for (size_t posn = 0; (posn + 32) <= size; ++posn) {
+        if (memcmp(data + posn, key, 32) == 0)
+            return true;
+    }
+    return false;
+}
+
+void testDirtyMemory()
+{
+    // Construct a cache on top of memory that looks like in-use slots.
+    static uint64_t dirty[(sizeof(KeyCache<AES256, 2>) + 7) / 8];
+    KeyCache<AES256, 2> *dirtyCache;
+    AES256 *a, *b;
+    bool ok;
+
+    Serial.print("Dirty Memory ... ");
+    memset(dirty, 0x02, sizeof(dirty));
+    dirtyCache = new (dirty) KeyCache<AES256, 2>();
+    a = dirtyCache->acquire(key1, 32);
+    b = dirtyCache->acquire(key2, 32);
+    ok = checkKey(a, key1) && checkKey(b, key2) && a != b;
+    dirtyCache->release(b);
+
+    // Destroying the cache must wipe the keys, even the acquired one.
+    dirtyCache->~KeyCache<AES256, 2>();
+    ok &= !containsKey((const byte *)dirty, sizeof(dirty), key1);
+    ok &= !containsKey((const byte *)dirty, sizeof(dirty), key2);
+    Serial.println(ok ? "Passed" : "Failed");
+}
+
+void perfKeyCache()
+{
+    unsigned long start;
+    unsigned long elapsed;
+    int count;
+
+    crypto_feed_watchdog();
+
+    Serial.print("AES256 Set Key ... ");
+    start = micros();
+    for (count = 0; count < 10000; ++count) {
+        reference.setKey(key1, 32);
+    }
+    elapsed = micros() - start;
+    Serial.print(elapsed / 10000.0);
+    Serial.print("us per operation, ");
+    Serial.print((10000.0 * 1000000.0) / elapsed);
+    Serial.println(" per second");
+
+    Serial.print("KeyCache<AES256> Acquire ... ");
+    start = micros();
+    for (count = 0; count < 10000; ++count) {
+        cache.release(cache.acquire(key1, 32));
+    }
+    elapsed = micros() - start;
+    Serial.print(elapsed / 10000.0);
+    Serial.print("us per operation, ");
+    Serial.print((10000.0 * 1000000.0) / elapsed);
+    Serial.println(" per second");
+
+    Serial.print("GCM<AES256> Set Key ... ");
+    GCM<AES256> *gcm = new GCM<AES256>();
+    start = micros();
+    for (count = 0; count < 1000; ++count) {
+        gcm->setKey(key1, 32);
+    }
+    elapsed = micros() - start;
+    delete gcm;
+    Serial.print(elapsed / 1000.0);
+    Serial.print("us per operation, ");
+    Serial.print((1000.0 * 1000000.0) / elapsed);
+    Serial.println(" per second");
+
+    Serial.print("KeyCache<GCM<AES256>> Acquire ... ");
+    KeyCache<GCM<AES256>, 2> *gcmCache = new KeyCache<GCM<AES256>, 2>();
+    start = micros();
+    for (count = 0; count < 1000; ++count) {
+        gcmCache->release(gcmCache->acquire(key1, 32));
+    }
+    elapsed = micros() - start;
+    delete gcmCache;
+    Serial.print(elapsed / 1000.0);
+    Serial.print("us per operation, ");
+    Serial.print((1000.0 * 1000000.0) / elapsed);
+    Serial.println(" per second");
+}
+
+void setup()
+{
+    Serial.begin(9600);
+
+    Serial.println();
+
+    Serial.println("State Sizes:");
+    Serial.print("KeyCache<AES256, 2> ... ");
+    Serial.println(sizeof(cache));
+    Serial.println();
+
+    memcpy(key1, baseKey, 32);
+    memcpy(key2, baseKey, 32);
+    memcpy(key3, baseKey, 32);
+    key2[31] ^= 0x01;
+    key3[0] ^= 0x80;
+
+    Serial.println("Test Vectors:");
+    testKeyCache();
+    testDirtyMemory();
+
+    Serial.println();
+
+    Serial.println("Performance Tests:");
+    perfKeyCache();
+}
+
+void loop()
+{
+}
@@ -221,6 +221,86 @@ void testEval()
     Serial.println(" us)");
 }
 
+// Scalars that are q or more must give the same answer as the scalar
+// reduced modulo q.  Only the low 521 bits of the scalar are used.
+void testLargeScalars()
+{
+    // q + 14, which makes the last window of the curve function land on
+    // the same multiple as the running total unless f is reduced first.
+    static uint8_t const scalar_q_plus_14[66] PROGMEM = {
+        0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFA, 0x51, 0x86, 0x87, 0x83, 0xBF, 0x2F,
+        0x96, 0x6B, 0x7F, 0xCC, 0x01, 0x48, 0xF7, 0x09,
+        0xA5, 0xD0, 0x3B, 0xB5, 0xC9, 0xB8, 0x89, 0x9C,
+        0x47, 0xAE, 0xBB, 0x6F, 0xB7, 0x1E, 0x91, 0x38,
+        0x64, 0x17
+    };
+    uint8_t result[132];
+    uint8_t expected[132];
+
+    Serial.println("Large scalars:");
+
+    Serial.print("(q + 14) * G ... ");
+    Serial.flush();
+    memcpy_P(alice_f, scalar_q_plus_14, 66);
+    P521::eval(result, alice_f, 0);
+    memset(bob_f, 0, 66);
+    bob_f[65] = 14;
+    P521::eval(expected, bob_f, 0);
+    if (memcmp(result, expected, 132) == 0) {
+        Serial.println("ok");
+    } else {
+        Serial.println("failed");
+        printNumber("actual  ", result, 132);
+        printNumber("expected", expected, 132);
+    }
+
+    Serial.print("(2^528 - 1) * G ... ");
+    Serial.flush();
+    memset(alice_f, 0xFF, 66);
+    P521::eval(result, alice_f, 0);
+    alice_f[0] = 0x01;
+    P521::eval(expected, alice_f, 0);
+    if (memcmp(result, expected, 132) == 0) {
+        Serial.println("ok");
+    } else {
+        Serial.println("failed");
+        printNumber("actual  ", result, 132);
+        printNumber("expected", expected, 132);
+    }
+
+    // derivePublicKey() takes a faster path than eval() for G, so check
+    // that it reduces the same out of range private keys.
+    Serial.print("derivePublicKey(q + 14) ... ");
+    Serial.flush();
+    memcpy_P(alice_f, scalar_q_plus_14, 66);
+    P521::derivePublicKey(result, alice_f);
+    P521::eval(expected, alice_f, 0);
+    if (memcmp(result, expected, 132) == 0) {
+        Serial.println("ok");
+    } else {
+        Serial.println("failed");
+        printNumber("actual  ", result, 132);
+        printNumber("expected", expected, 132);
+    }
+
+    Serial.print("derivePublicKey(2^528 - 1) ... ");
+    Serial.flush();
+    memset(alice_f, 0xFF, 66);
+    P521::derivePublicKey(result, alice_f);
+    P521::eval(expected, alice_f, 0);
+    if (memcmp(result, expected, 132) == 0) {
+        Serial.println("ok");
+    } else {
+        Serial.println("failed");
+        printNumber("actual  ", result, 132);
+        printNumber("expected", expected, 132);
+    }
+}
+
 void testDH()
 {
     Serial.println("Diffie-Hellman key exchange:");
@@ -491,6 +571,42 @@ void testSignSHA512(const struct TestSignVector *test)
     testSignCommon(test, &hash);
 }
 
+// Signs a message that was already hashed with SHA512, which generates
+// k values with the built-in SHA512 path in P521::sign().
+void testSignPrehashed(const struct TestSignVector *_test)
+{
+    uint8_t *privateKey = alice_f;
+    uint8_t *sig = bob_k;
+    uint8_t digest[64];
+    static TestSignVector test;
+    SHA512 hash;
+
+    memcpy_P(&test, _test, sizeof(test));
+
+    Serial.print(test.name);
+    Serial.print(" Sign Prehashed ... ");
+    Serial.flush();
+
+    memcpy_P(privateKey, testKeyP521.privateKey, 66);
+    hash.update(test.data, strlen(test.data));
+    hash.finalize(digest, sizeof(digest));
+
+    unsigned long start = micros();
+    P521::sign(sig, privateKey, digest, sizeof(digest));
+    unsigned long elapsed = micros() - start;
+    Serial.print(elapsed);
+    Serial.print(" us ... ");
+
+    bool ok = !memcmp(sig, test.signature, 132);
+    if (ok) {
+        Serial.println("ok");
+    } else {
+        Serial.println("failed");
+        printNumber("actual  ", sig, 132);
+        printNumber("expected", test.signature, 132);
+    }
+}
+
 void testSign()
 {
     Serial.println("Digital signatures:");
@@ -498,6 +614,8 @@ void testSign()
     testSignSHA512(&testVectorP521_2);
     testSignSHA256(&testVectorP521_3);
     testSignSHA512(&testVectorP521_4);
+    testSignPrehashed(&testVectorP521_2);
+    testSignPrehashed(&testVectorP521_4);
 }
 
 void setup()
@@ -512,6 +630,8 @@ void setup()
     // Perform the tests.
     testEval();
     Serial.println();
+    testLargeScalars();
+    Serial.println();
     testDH();
     Serial.println();
     testSign();
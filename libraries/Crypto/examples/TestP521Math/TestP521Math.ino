@@ -22,7 +22,8 @@
 
 /*
 This example runs tests on the P521 field mathematics independent
-of the full curve operation itself.
+of the full curve operation itself.  It also cross-checks the
+variable-time point helpers against the public eval() function.
 */
 
 // Enable access to the internals of P521 to test the raw field ops.
@@ -596,6 +597,208 @@ void testRecip()
     Serial.println();
 }
 
+// Computes n * G in affine co-ordinates using the public API.
+void multipleOfG(limb_t *x, limb_t *y, const uint8_t n[66])
+{
+    uint8_t point[132];
+    P521::eval(point, n, 0);
+    BigNumberUtil::unpackBE(x, NUM_LIMBS, point, 66);
+    BigNumberUtil::unpackBE(y, NUM_LIMBS, point + 66, 66);
+}
+
+// Computes small * G in affine co-ordinates.
+void multipleOfG(limb_t *x, limb_t *y, uint8_t small)
+{
+    uint8_t n[66];
+    memset(n, 0, sizeof(n));
+    n[65] = small;
+    multipleOfG(x, y, n);
+}
+
+// Checks that the Jacobian point (x, y, z) is the same as small * G,
+// where zero indicates the point at infinity.
+void checkPoint(const char *name, const limb_t *x, const limb_t *y,
+                const limb_t *z, uint8_t small)
+{
+    limb_t ex[NUM_LIMBS];
+    limb_t ey[NUM_LIMBS];
+    limb_t ax[NUM_LIMBS];
+    limb_t ay[NUM_LIMBS];
+    bool ok;
+
+    Serial.print(name);
+    Serial.print(": ");
+    if (small == 0) {
+        ok = BigNumberUtil::isZero(z, NUM_LIMBS);
+    } else if (BigNumberUtil::isZero(z, NUM_LIMBS)) {
+        ok = false;
+    } else {
+        // (x, y) = (x / z^2, y / z^3)
+        multipleOfG(ex, ey, small);
+        P521::recip(temp, z);
+        P521::square(ax, temp);
+        P521::mul(ay, ax, temp);
+        P521::mul(ax, ax, x);
+        P521::mul(ay, ay, y);
+        ok = compare(ax, ex) == 0 && compare(ay, ey) == 0;
+    }
+    Serial.println(ok ? "ok" : "failed");
+}
+
+void testPointAdd()
+{
+    limb_t gx[NUM_LIMBS];
+    limb_t gy[NUM_LIMBS];
+    limb_t x[NUM_LIMBS];
+    limb_t y[NUM_LIMBS];
+    limb_t z[NUM_LIMBS];
+
+    Serial.println("Variable-time point addition:");
+    multipleOfG(gx, gy, 1);
+    memset(temp, 0, sizeof(temp));
+    temp[0] = 1;
+
+    // Infinity + G = G.
+    memset(z, 0, sizeof(z));
+    P521::addPointVarTime(x, y, z, gx, gy, 0);
+    checkPoint("O + G", x, y, z, 1);
+
+    // G + G = 2G, with the second point affine and then Jacobian.
+    P521::addPointVarTime(x, y, z, gx, gy, 0);
+    checkPoint("G + G", x, y, z, 2);
+    memcpy(arg1, x, sizeof(arg1));
+    memcpy(arg2, y, sizeof(arg2));
+    memcpy(result, z, sizeof(result));
+    P521::addPointVarTime(x, y, z, arg1, arg2, result);
+    checkPoint("2G + 2G", x, y, z, 4);
+
+    // 4G + G = 5G.
+    P521::addPointVarTime(x, y, z, gx, gy, 0);
+    checkPoint("4G + G", x, y, z, 5);
+
+    // 5G + (-5G) = O.
+    memcpy(arg1, x, sizeof(arg1));
+    memset(result, 0, sizeof(result));
+    P521::sub(arg2, result, y);
+    memcpy(result, z, sizeof(result));
+    P521::addPointVarTime(x, y, z, arg1, arg2, result);
+    checkPoint("5G - 5G", x, y, z, 0);
+
+    Serial.println();
+}
+
+void testJoint(const char *name, const uint8_t f1[66], const uint8_t f2[66],
+               bool negate, const uint8_t expected[66])
+{
+    limb_t x[NUM_LIMBS];
+    limb_t y[NUM_LIMBS];
+    limb_t ex[NUM_LIMBS];
+    limb_t ey[NUM_LIMBS];
+    bool ok;
+
+    Serial.print(name);
+    Serial.print(": ");
+    Serial.flush();
+
+    // Use G or -G as the second point.
+    multipleOfG(x, y, 1);
+    if (negate) {
+        memset(temp, 0, sizeof(temp));
+        P521::sub(y, temp, y);
+    }
+
+    ok = P521::evaluateJoint(x, y, f1, f2);
+    if (!expected) {
+        ok = !ok;
+    } else if (ok) {
+        multipleOfG(ex, ey, expected);
+        ok = compare(x, ex) == 0 && compare(y, ey) == 0;
+    }
+    Serial.println(ok ? "ok" : "failed");
+}
+
+void testJoint()
+{
+    uint8_t f1[66];
+    uint8_t f2[66];
+    uint8_t sum[66];
+    uint16_t carry;
+    uint8_t index;
+
+    Serial.println("Joint multiplication:");
+
+    // Two scalars less than 2^519 so that their sum is less than q.
+    for (index = 0; index < 66; ++index) {
+        f1[index] = (uint8_t)(index * 37 + 11);
+        f2[index] = (uint8_t)(index * 91 + 200);
+    }
+    f1[0] = f2[0] = 0;
+    f1[1] &= 0x7F;
+    f2[1] &= 0x7F;
+    carry = 0;
+    for (index = 66; index > 0; --index) {
+        carry += f1[index - 1];
+        carry += f2[index - 1];
+        sum[index - 1] = (uint8_t)carry;
+        carry >>= 8;
+    }
+    testJoint("f1 * G + f2 * G", f1, f2, false, sum);
+
+    // Identical scalars.
+    carry = 0;
+    for (index = 66; index > 0; --index) {
+        carry += f1[index - 1] * 2;
+        sum[index - 1] = (uint8_t)carry;
+        carry >>= 8;
+    }
+    testJoint("f1 * G + f1 * G", f1, f1, false, sum);
+
+    // Cancelling terms produce the point at infinity.
+    testJoint("f1 * G - f1 * G", f1, f1, true, 0);
+
+    // One of the scalars is zero.
+    memset(f2, 0, sizeof(f2));
+    testJoint("f1 * G + 0 * G", f1, f2, false, f1);
+    testJoint("0 * G + f1 * G", f2, f1, false, f1);
+
+    Serial.println();
+}
+
+void testNormalize()
+{
+    limb_t points[3][3][NUM_LIMBS];
+    limb_t x[NUM_LIMBS];
+    limb_t y[NUM_LIMBS];
+    uint8_t index;
+    bool ok = true;
+
+    Serial.print("Normalize points: ");
+    Serial.flush();
+
+    // Build G, 2G, and 3G in Jacobian co-ordinates with z != 1.
+    multipleOfG(x, y, 1);
+    memset(points, 0, sizeof(points));
+    P521::addPointVarTime(points[0][0], points[0][1], points[0][2], x, y, 0);
+    P521::dblPoint(points[0][0], points[0][1], points[0][2],
+                   points[0][0], points[0][1], points[0][2]);
+    P521::addPointVarTime(points[0][0], points[0][1], points[0][2], x, y, 0);
+    memcpy(points[1], points[0], sizeof(points[0]));
+    P521::addPointVarTime(points[1][0], points[1][1], points[1][2], x, y, 0);
+    memcpy(points[2], points[1], sizeof(points[1]));
+    P521::addPointVarTime(points[2][0], points[2][1], points[2][2], x, y, 0);
+
+    // Convert to affine and compare against 3G, 4G, and 5G.
+    P521::normalizePoints(points[0][0], 3);
+    for (index = 0; index < 3; ++index) {
+        multipleOfG(x, y, index + 3);
+        if (compare(points[index][0], x) != 0 ||
+                compare(points[index][1], y) != 0 ||
+                compare(points[index][2], num_1) != 0)
+            ok = false;
+    }
+    Serial.println(ok ? "ok" : "failed");
+}
+
 void setup()
 {
     Serial.begin(9600);
@@ -605,6 +808,9 @@ void setup()
     testMul();
     testMove();
     testRecip();
+    testPointAdd();
+    testJoint();
+    testNormalize();
 }
 
 void loop()
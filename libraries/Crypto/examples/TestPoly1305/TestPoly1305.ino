@@ -143,6 +143,44 @@ void testPoly1305(Poly1305 *hash, const struct TestPoly1305Vector *test)
         Serial.println("Failed");
 }
 
+void testLongMessage(Poly1305 *hash)
+{
+    static byte const key[16] = {
+        0xFF, 0xFF, 0xFF, 0x0F, 0xFC, 0xFF, 0xFF, 0x0F,
+        0xFC, 0xFF, 0xFF, 0x0F, 0xFC, 0xFF, 0xFF, 0x0F
+    };
+    byte token1[16];
+    byte token2[16];
+    size_t posn;
+    int count;
+
+    Serial.print("Long Message ... ");
+
+    // Fill the buffer with a mix of all-ones bytes and a counting pattern.
+    for (posn = 0; posn < sizeof(buffer); ++posn)
+        buffer[posn] = (posn < 48) ? 0xFF : (byte)(posn * 37);
+
+    // Hash the buffer several times in large updates and then again one
+    // byte at a time.  Both must produce the same token.
+    hash->reset(key);
+    for (count = 0; count < 5; ++count)
+        hash->update(buffer, sizeof(buffer));
+    hash->update(buffer, 7);
+    hash->finalize(key, token1, sizeof(token1));
+    hash->reset(key);
+    for (count = 0; count < 5; ++count) {
+        for (posn = 0; posn < sizeof(buffer); ++posn)
+            hash->update(buffer + posn, 1);
+    }
+    hash->update(buffer, 7);
+    hash->finalize(key, token2, sizeof(token2));
+
+    if (memcmp(token1, token2, sizeof(token1)) == 0)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
 void perfPoly1305(Poly1305 *hash)
 {
     unsigned long start;
@@ -224,6 +262,7 @@ void setup()
     testPoly1305(&poly1305, &testVectorPoly1305_2);
     testPoly1305(&poly1305, &testVectorPoly1305_3);
     testPoly1305(&poly1305, &testVectorPoly1305_4);
+    testLongMessage(&poly1305);
 
     Serial.println();
 
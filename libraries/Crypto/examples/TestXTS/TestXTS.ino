@@ -262,6 +262,78 @@ void testXTS(XTSCommon *cipher, const struct TestVector *test)
         printlnProgMem("Failed");
 }
 
+void testSectors(XTSCommon *cipher, const struct TestVector *test)
+{
+    uint64_t sectorNumber;
+    size_t sectorSize, count, posn;
+    bool ok;
+
+    crypto_feed_watchdog();
+
+    memcpy_P(&testVector, test, sizeof(testVector));
+
+    Serial.print(testVector.name);
+    printProgMem(" Encrypt Sectors ... ");
+
+    // The test vector tweak is a little-endian sector number.
+    sectorNumber = 0;
+    for (posn = 8; posn > 0; --posn)
+        sectorNumber = (sectorNumber << 8) | testVector.tweak[posn - 1];
+
+    cipher->setSectorSize(testVector.sectorSize);
+    cipher->setKey(testVector.key1, 32);
+    cipher->encryptSectors(buffer, testVector.plaintext, sectorNumber, 1);
+    ok = !memcmp(buffer, testVector.ciphertext, testVector.sectorSize);
+
+    // Encrypt a run of short sectors and compare against the results of
+    // encrypting each sector individually with setTweak().
+    sectorSize = testVector.sectorSize < 32 ? testVector.sectorSize : 32;
+    count = sizeof(buffer) / sectorSize;
+    cipher->setSectorSize(sectorSize);
+    for (posn = 0; posn < count * sectorSize; ++posn)
+        buffer[posn] = (byte)(posn * 7);
+    cipher->encryptSectors(buffer, buffer, sectorNumber, count);
+    for (posn = 0; posn < count && ok; ++posn) {
+        byte sector[32];
+        byte tweak[8];
+        uint64_t number = sectorNumber + posn;
+        for (size_t index = 0; index < sectorSize; ++index)
+            sector[index] = (byte)((posn * sectorSize + index) * 7);
+        for (size_t index = 0; index < 8; ++index) {
+            tweak[index] = (byte)number;
+            number >>= 8;
+        }
+        cipher->setTweak(tweak, sizeof(tweak));
+        cipher->encryptSector(sector, sector);
+        if (memcmp(buffer + posn * sectorSize, sector, sectorSize) != 0)
+            ok = false;
+    }
+
+    if (ok)
+        printlnProgMem("Passed");
+    else
+        printlnProgMem("Failed");
+
+    Serial.print(testVector.name);
+    printProgMem(" Decrypt Sectors ... ");
+
+    cipher->decryptSectors(buffer, buffer, sectorNumber, count);
+    ok = true;
+    for (posn = 0; posn < count * sectorSize; ++posn) {
+        if (buffer[posn] != (byte)(posn * 7))
+            ok = false;
+    }
+    cipher->setSectorSize(testVector.sectorSize);
+    cipher->decryptSectors(buffer, testVector.ciphertext, sectorNumber, 1);
+    if (memcmp(buffer, testVector.plaintext, testVector.sectorSize) != 0)
+        ok = false;
+
+    if (ok)
+        printlnProgMem("Passed");
+    else
+        printlnProgMem("Failed");
+}
+
 void perfEncrypt(const char *name, XTSCommon *cipher, const struct TestVector *test, size_t keySize = 32)
 {
     unsigned long start;
@@ -406,6 +478,9 @@ void setup()
     testXTS(xtsaes128, &testVectorXTSAES128_4);
     testXTS(xtsaes128, &testVectorXTSAES128_15);
     testXTS(xtsaes128, &testVectorXTSAES128_16);
+    testSectors(xtsaes128, &testVectorXTSAES128_4);
+    testSectors(xtsaes128, &testVectorXTSAES128_15);
+    testSectors(xtsaes128, &testVectorXTSAES128_16);
 
     Serial.println();
 
@@ -32,6 +32,48 @@
 #define CRYPTO_AES_DEFAULT 1
 #endif
 
+// Determine if the host CPU may have AES instructions that can be selected
+// at runtime by the default implementation.  Define CRYPTO_NO_AES_HW to
+// always use the portable table-based implementation instead.
+#if defined(CRYPTO_AES_DEFAULT) && !defined(CRYPTO_NO_AES_HW) && defined(__GNUC__)
+#if defined(__x86_64__) || defined(__i386__)
+#define CRYPTO_AES_HW 1
+#elif defined(__aarch64__) && defined(__linux__) && \
+      (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define CRYPTO_AES_HW 1
+#endif
+#endif
+
+// On 64-bit hosts without AES instructions, use a constant-time bitsliced
+// implementation instead of the S-box tables.  Define CRYPTO_NO_AES_BITSLICED
+// to always use the table-based implementation instead.
+#if defined(CRYPTO_AES_DEFAULT) && !defined(CRYPTO_NO_AES_BITSLICED) && \
+    (defined(__LP64__) || defined(_WIN64))
+#define CRYPTO_AES_BITSLICED 1
+#endif
+
+// Define CRYPTO_AES_INV_SCHEDULE here or in the compiler flags to have
+// setKey() also precompute the round keys for the equivalent inverse cipher
+// when the tables are in use, so that decryption can use a combined
+// InvSubBytes/InvMixColumns table.  This makes decryptBlock() about as fast
+// as encryptBlock() at the cost of one extra key schedule of RAM.  The
+// combined table is 1K of 32-bit words indexed by the secret state, where
+// the table path otherwise only looks up bytes in the 256-byte inverse
+// S-box.  Only use this on devices without a data cache where the time of
+// a memory access does not depend upon its address, such as AVR or the
+// Cortex-M4 in the nRF52.  Never use it on a host system or on a part with
+// a data cache such as the ESP32 or the Cortex-M7.
+#if defined(CRYPTO_AES_INV_SCHEDULE) && \
+    (!defined(CRYPTO_AES_DEFAULT) || defined(CRYPTO_AES_BITSLICED))
+#undef CRYPTO_AES_INV_SCHEDULE
+#endif
+
+// Objects hold a second key schedule for the equivalent inverse cipher when
+// either the tables or the AES instructions decrypt with it.
+#if defined(CRYPTO_AES_INV_SCHEDULE) || defined(CRYPTO_AES_HW)
+#define CRYPTO_AES_INV_ROUND_KEYS 1
+#endif
+
 #if defined(CRYPTO_AES_DEFAULT) || defined(CRYPTO_DOC)
 
 class AESTiny128;
@@ -49,6 +91,9 @@ public:
     void encryptBlock(uint8_t *output, const uint8_t *input);
     void decryptBlock(uint8_t *output, const uint8_t *input);
 
+    void encryptBlocks(uint8_t *output, const uint8_t *input, size_t count);
+    void decryptBlocks(uint8_t *output, const uint8_t *input, size_t count);
+
     void clear();
 
 protected:
@@ -57,6 +102,12 @@ protected:
     /** @cond aes_internal */
     uint8_t rounds;
     uint8_t *schedule;
+#if defined(CRYPTO_AES_BITSLICED)
+    uint64_t *bitsliced;
+#endif
+#if defined(CRYPTO_AES_INV_ROUND_KEYS)
+    uint8_t *invSchedule;
+#endif
 
     static void subBytesAndShiftRows(uint8_t *output, const uint8_t *input);
     static void inverseShiftRowsAndSubBytes(uint8_t *output, const uint8_t *input);
@@ -64,12 +115,50 @@ protected:
     static void inverseMixColumn(uint8_t *output, const uint8_t *input);
     static void keyScheduleCore(uint8_t *output, const uint8_t *input, uint8_t iteration);
     static void applySbox(uint8_t *output, const uint8_t *input);
+
+#if defined(CRYPTO_AES_INV_SCHEDULE)
+    static void invKeySchedule(uint8_t *invSchedule, const uint8_t *schedule,
+                               uint8_t rounds);
+#endif
+#if defined(CRYPTO_AES_HW) || defined(CRYPTO_AES_BITSLICED)
+    static void expandKey(uint8_t *schedule, const uint8_t *key,
+                          uint8_t keyWords, uint8_t rounds,
+                          uint32_t (*subWord)(uint32_t word));
+#endif
+#if defined(CRYPTO_AES_HW)
+    static bool hwAvailable();
+    static void hwKeySchedule(uint8_t *schedule, uint8_t *invSchedule,
+                              const uint8_t *key, uint8_t keyWords,
+                              uint8_t rounds);
+    static void hwEncryptBlock(const uint8_t *schedule, uint8_t rounds,
+                               uint8_t *output, const uint8_t *input);
+    static void hwDecryptBlock(const uint8_t *invSchedule, uint8_t rounds,
+                               uint8_t *output, const uint8_t *input);
+    static void hwEncryptBlocks(const uint8_t *schedule, uint8_t rounds,
+                                uint8_t *output, const uint8_t *input,
+                                size_t count);
+    static void hwDecryptBlocks(const uint8_t *invSchedule, uint8_t rounds,
+                                uint8_t *output, const uint8_t *input,
+                                size_t count);
+#endif
+#if defined(CRYPTO_AES_BITSLICED)
+    static void bsKeySchedule(uint64_t *bitsliced, uint8_t *schedule,
+                              const uint8_t *key, uint8_t keyWords,
+                              uint8_t rounds);
+    static void bsEncryptBlocks(const uint64_t *bitsliced, uint8_t rounds,
+                                uint8_t *output, const uint8_t *input,
+                                size_t count);
+    static void bsDecryptBlocks(const uint64_t *bitsliced, uint8_t rounds,
+                                uint8_t *output, const uint8_t *input,
+                                size_t count);
+#endif
     /** @endcond */
 
     friend class AESTiny128;
     friend class AESTiny256;
     friend class AESSmall128;
     friend class AESSmall256;
+    friend class GCMCommon;
 };
 
 class AES128 : public AESCommon
@@ -84,6 +173,12 @@ public:
 
 private:
     uint8_t sched[176];
+#if defined(CRYPTO_AES_BITSLICED)
+    uint64_t bsched[11 * 8];
+#endif
+#if defined(CRYPTO_AES_INV_ROUND_KEYS)
+    uint8_t isched[176];
+#endif
 };
 
 class AES192 : public AESCommon
@@ -98,6 +193,12 @@ public:
 
 private:
     uint8_t sched[208];
+#if defined(CRYPTO_AES_BITSLICED)
+    uint64_t bsched[13 * 8];
+#endif
+#if defined(CRYPTO_AES_INV_ROUND_KEYS)
+    uint8_t isched[208];
+#endif
 };
 
 class AES256 : public AESCommon
@@ -112,6 +213,12 @@ public:
 
 private:
     uint8_t sched[240];
+#if defined(CRYPTO_AES_BITSLICED)
+    uint64_t bsched[15 * 8];
+#endif
+#if defined(CRYPTO_AES_INV_ROUND_KEYS)
+    uint8_t isched[240];
+#endif
 };
 
 class AESTiny256 : public BlockCipher
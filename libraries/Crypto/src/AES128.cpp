@@ -43,11 +43,23 @@ AES128::AES128()
 {
     rounds = 10;
     schedule = sched;
+#if defined(CRYPTO_AES_BITSLICED)
+    bitsliced = bsched;
+#endif
+#if defined(CRYPTO_AES_INV_ROUND_KEYS)
+    invSchedule = isched;
+#endif
 }
 
 AES128::~AES128()
 {
     clean(sched);
+#if defined(CRYPTO_AES_BITSLICED)
+    clean(bsched);
+#endif
+#if defined(CRYPTO_AES_INV_ROUND_KEYS)
+    clean(isched);
+#endif
 }
 
 /**
@@ -64,6 +76,16 @@ bool AES128::setKey(const uint8_t *key, size_t len)
     if (len != 16)
         return false;
 
+#if defined(CRYPTO_AES_HW)
+    if (hwAvailable()) {
+        hwKeySchedule(sched, isched, key, 4, rounds);
+        return true;
+    }
+#endif
+
+#if defined(CRYPTO_AES_BITSLICED)
+    bsKeySchedule(bsched, sched, key, 4, rounds);
+#else
     // Copy the key itself into the first 16 bytes of the schedule.
     uint8_t *schedule = sched;
     memcpy(schedule, key, 16);
@@ -96,6 +118,12 @@ bool AES128::setKey(const uint8_t *key, size_t len)
         ++w;
     }
 
+#if defined(CRYPTO_AES_INV_SCHEDULE)
+    // Derive the round keys for the equivalent inverse cipher.
+    invKeySchedule(isched, sched, rounds);
+#endif
+#endif
+
     return true;
 }
 
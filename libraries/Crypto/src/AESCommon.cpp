@@ -22,7 +22,9 @@
 
 #include "AES.h"
 #include "Crypto.h"
+#include "utility/EndianUtil.h"
 #include "utility/ProgMemUtil.h"
+#include <string.h>
 
 #if defined(CRYPTO_AES_DEFAULT) || defined(CRYPTO_DOC)
 
@@ -40,6 +42,27 @@
  * and decryption operations.  Unless AES compatibility is required,
  * it is recommended that the ChaCha stream cipher be used instead.
  *
+ * On x86 and ARMv8 hosts the AES instructions of the CPU (AES-NI or the
+ * ARMv8 Cryptography Extensions) are used instead of the tables if the
+ * CPU supports them.  This is detected at runtime.  The hardware path
+ * has constant timing and is much faster.  Define CRYPTO_NO_AES_HW when
+ * compiling the library to always use the table-based implementation.
+ *
+ * On other 64-bit hosts a bitsliced implementation is used in place of
+ * the tables.  It has constant timing and processes four blocks at once
+ * in encryptBlocks() and decryptBlocks().  Define CRYPTO_NO_AES_BITSLICED
+ * when compiling the library to use the tables instead.  Other platforms
+ * such as AVR and ARM Cortex-M always use the tables.
+ *
+ * If CRYPTO_AES_INV_SCHEDULE is defined when compiling the library and
+ * the tables are in use, setKey() also computes the key schedule for the
+ * equivalent inverse cipher, which allows decryptBlock() to run about as
+ * fast as encryptBlock() at the cost of an extra 176 to 240 bytes of RAM
+ * per object.  It uses a 1K table indexed by the secret state, so it is
+ * off by default and should only be enabled on devices without a data
+ * cache.  See the note in AES.h for details.  The AESTiny and AESSmall
+ * variants never keep a second schedule.
+ *
  * Reference: http://en.wikipedia.org/wiki/Advanced_Encryption_Standard
  *
  * \sa ChaCha, AES128, AES192, AES256
@@ -119,6 +142,80 @@ static uint8_t const sbox_inverse[256] PROGMEM = {
     0xE1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0C, 0x7D
 };
 
+#if defined(CRYPTO_AES_INV_SCHEDULE)
+
+// Combined InvSubBytes and InvMixColumns table for the equivalent inverse
+// cipher.  Entry x is the column {0E, 09, 0D, 0B} * sbox_inverse[x] with
+// row 0 in the low byte.  The other rows are obtained by rotation.
+static uint32_t const inv_table[256] PROGMEM = {
+    0x50A7F451, 0x5365417E, 0xC3A4171A, 0x965E273A,     // 0x00
+    0xCB6BAB3B, 0xF1459D1F, 0xAB58FAAC, 0x9303E34B,
+    0x55FA3020, 0xF66D76AD, 0x9176CC88, 0x254C02F5,
+    0xFCD7E54F, 0xD7CB2AC5, 0x80443526, 0x8FA362B5,
+    0x495AB1DE, 0x671BBA25, 0x980EEA45, 0xE1C0FE5D,     // 0x10
+    0x02752FC3, 0x12F04C81, 0xA397468D, 0xC6F9D36B,
+    0xE75F8F03, 0x959C9215, 0xEB7A6DBF, 0xDA595295,
+    0x2D83BED4, 0xD3217458, 0x2969E049, 0x44C8C98E,
+    0x6A89C275, 0x78798EF4, 0x6B3E5899, 0xDD71B927,     // 0x20
+    0xB64FE1BE, 0x17AD88F0, 0x66AC20C9, 0xB43ACE7D,
+    0x184ADF63, 0x82311AE5, 0x60335197, 0x457F5362,
+    0xE07764B1, 0x84AE6BBB, 0x1CA081FE, 0x942B08F9,
+    0x58684870, 0x19FD458F, 0x876CDE94, 0xB7F87B52,     // 0x30
+    0x23D373AB, 0xE2024B72, 0x578F1FE3, 0x2AAB5566,
+    0x0728EBB2, 0x03C2B52F, 0x9A7BC586, 0xA50837D3,
+    0xF2872830, 0xB2A5BF23, 0xBA6A0302, 0x5C8216ED,
+    0x2B1CCF8A, 0x92B479A7, 0xF0F207F3, 0xA1E2694E,     // 0x40
+    0xCDF4DA65, 0xD5BE0506, 0x1F6234D1, 0x8AFEA6C4,
+    0x9D532E34, 0xA055F3A2, 0x32E18A05, 0x75EBF6A4,
+    0x39EC830B, 0xAAEF6040, 0x069F715E, 0x51106EBD,
+    0xF98A213E, 0x3D06DD96, 0xAE053EDD, 0x46BDE64D,     // 0x50
+    0xB58D5491, 0x055DC471, 0x6FD40604, 0xFF155060,
+    0x24FB9819, 0x97E9BDD6, 0xCC434089, 0x779ED967,
+    0xBD42E8B0, 0x888B8907, 0x385B19E7, 0xDBEEC879,
+    0x470A7CA1, 0xE90F427C, 0xC91E84F8, 0x00000000,     // 0x60
+    0x83868009, 0x48ED2B32, 0xAC70111E, 0x4E725A6C,
+    0xFBFF0EFD, 0x5638850F, 0x1ED5AE3D, 0x27392D36,
+    0x64D90F0A, 0x21A65C68, 0xD1545B9B, 0x3A2E3624,
+    0xB1670A0C, 0x0FE75793, 0xD296EEB4, 0x9E919B1B,     // 0x70
+    0x4FC5C080, 0xA220DC61, 0x694B775A, 0x161A121C,
+    0x0ABA93E2, 0xE52AA0C0, 0x43E0223C, 0x1D171B12,
+    0x0B0D090E, 0xADC78BF2, 0xB9A8B62D, 0xC8A91E14,
+    0x8519F157, 0x4C0775AF, 0xBBDD99EE, 0xFD607FA3,     // 0x80
+    0x9F2601F7, 0xBCF5725C, 0xC53B6644, 0x347EFB5B,
+    0x7629438B, 0xDCC623CB, 0x68FCEDB6, 0x63F1E4B8,
+    0xCADC31D7, 0x10856342, 0x40229713, 0x2011C684,
+    0x7D244A85, 0xF83DBBD2, 0x1132F9AE, 0x6DA129C7,     // 0x90
+    0x4B2F9E1D, 0xF330B2DC, 0xEC52860D, 0xD0E3C177,
+    0x6C16B32B, 0x99B970A9, 0xFA489411, 0x2264E947,
+    0xC48CFCA8, 0x1A3FF0A0, 0xD82C7D56, 0xEF903322,
+    0xC74E4987, 0xC1D138D9, 0xFEA2CA8C, 0x360BD498,     // 0xA0
+    0xCF81F5A6, 0x28DE7AA5, 0x268EB7DA, 0xA4BFAD3F,
+    0xE49D3A2C, 0x0D927850, 0x9BCC5F6A, 0x62467E54,
+    0xC2138DF6, 0xE8B8D890, 0x5EF7392E, 0xF5AFC382,
+    0xBE805D9F, 0x7C93D069, 0xA92DD56F, 0xB31225CF,     // 0xB0
+    0x3B99ACC8, 0xA77D1810, 0x6E639CE8, 0x7BBB3BDB,
+    0x097826CD, 0xF418596E, 0x01B79AEC, 0xA89A4F83,
+    0x656E95E6, 0x7EE6FFAA, 0x08CFBC21, 0xE6E815EF,
+    0xD99BE7BA, 0xCE366F4A, 0xD4099FEA, 0xD67CB029,     // 0xC0
+    0xAFB2A431, 0x31233F2A, 0x3094A5C6, 0xC066A235,
+    0x37BC4E74, 0xA6CA82FC, 0xB0D090E0, 0x15D8A733,
+    0x4A9804F1, 0xF7DAEC41, 0x0E50CD7F, 0x2FF69117,
+    0x8DD64D76, 0x4DB0EF43, 0x544DAACC, 0xDF0496E4,     // 0xD0
+    0xE3B5D19E, 0x1B886A4C, 0xB81F2CC1, 0x7F516546,
+    0x04EA5E9D, 0x5D358C01, 0x737487FA, 0x2E410BFB,
+    0x5A1D67B3, 0x52D2DB92, 0x335610E9, 0x1347D66D,
+    0x8C61D79A, 0x7A0CA137, 0x8E14F859, 0x893C13EB,     // 0xE0
+    0xEE27A9CE, 0x35C961B7, 0xEDE51CE1, 0x3CB1477A,
+    0x59DFD29C, 0x3F73F255, 0x79CE1418, 0xBF37C773,
+    0xEACDF753, 0x5BAAFD5F, 0x146F3DDF, 0x86DB4478,
+    0x81F3AFCA, 0x3EC468B9, 0x2C342438, 0x5F40A3C2,     // 0xF0
+    0x72C31D16, 0x0C25E2BC, 0x8B493C28, 0x41950DFF,
+    0x7101A839, 0xDEB30C08, 0x9CE4B4D8, 0x90C15664,
+    0x6184CB7B, 0x70B632D5, 0x745C6C48, 0x4257B8D0
+};
+
+#endif
+
 /** @endcond */
 
 /**
@@ -126,6 +223,12 @@ static uint8_t const sbox_inverse[256] PROGMEM = {
  */
 AESCommon::AESCommon()
     : rounds(0), schedule(0)
+#if defined(CRYPTO_AES_BITSLICED)
+    , bitsliced(0)
+#endif
+#if defined(CRYPTO_AES_INV_ROUND_KEYS)
+    , invSchedule(0)
+#endif
 {
 }
 
@@ -265,10 +368,49 @@ void AESCommon::inverseMixColumn(uint8_t *output, const uint8_t *input)
     output[3] = a8 ^ a2 ^ a ^ b8 ^ b4 ^ b ^ c8 ^ c ^ d8 ^ d4 ^ d2;
 }
 
+#if defined(CRYPTO_AES_INV_SCHEDULE)
+
+#define INV_TABLE(x)    pgm_read_dword(inv_table + (x))
+#define ROTL(x, n)      (((x) << (n)) | ((x) >> (32 - (n))))
+#define INV_COLUMN(col) \
+    do { \
+        uint32_t t = INV_TABLE(IN((col), 0)) ^ \
+            ROTL(INV_TABLE(IN(((col) + 3) & 3, 1)), 8) ^ \
+            ROTL(INV_TABLE(IN(((col) + 2) & 3, 2)), 16) ^ \
+            ROTL(INV_TABLE(IN(((col) + 1) & 3, 3)), 24); \
+        OUT((col), 0) = ((uint8_t)t) ^ roundKey[(col) * 4]; \
+        OUT((col), 1) = ((uint8_t)(t >> 8)) ^ roundKey[(col) * 4 + 1]; \
+        OUT((col), 2) = ((uint8_t)(t >> 16)) ^ roundKey[(col) * 4 + 2]; \
+        OUT((col), 3) = ((uint8_t)(t >> 24)) ^ roundKey[(col) * 4 + 3]; \
+    } while (0)
+
+// Performs InvShiftRows, InvSubBytes, InvMixColumns, and AddRoundKey for
+// one round of the equivalent inverse cipher.
+static void inverseRound(uint8_t *output, const uint8_t *input,
+                         const uint8_t *roundKey)
+{
+    INV_COLUMN(0);
+    INV_COLUMN(1);
+    INV_COLUMN(2);
+    INV_COLUMN(3);
+}
+
+#endif
+
 /** @endcond */
 
 void AESCommon::encryptBlock(uint8_t *output, const uint8_t *input)
 {
+#if defined(CRYPTO_AES_HW)
+    if (hwAvailable()) {
+        hwEncryptBlock(schedule, rounds, output, input);
+        return;
+    }
+#endif
+
+#if defined(CRYPTO_AES_BITSLICED)
+    bsEncryptBlocks(bitsliced, rounds, output, input, 1);
+#else
     const uint8_t *roundKey = schedule;
     uint8_t posn;
     uint8_t round;
@@ -296,10 +438,48 @@ void AESCommon::encryptBlock(uint8_t *output, const uint8_t *input)
     subBytesAndShiftRows(state2, state1);
     for (posn = 0; posn < 16; ++posn)
         output[posn] = state2[posn] ^ roundKey[posn];
+#endif
 }
 
 void AESCommon::decryptBlock(uint8_t *output, const uint8_t *input)
 {
+#if defined(CRYPTO_AES_HW)
+    if (hwAvailable()) {
+        hwDecryptBlock(invSchedule, rounds, output, input);
+        return;
+    }
+#endif
+
+#if defined(CRYPTO_AES_BITSLICED)
+    bsDecryptBlocks(bitsliced, rounds, output, input, 1);
+#elif defined(CRYPTO_AES_INV_SCHEDULE)
+    const uint8_t *roundKey = invSchedule + rounds * 16;
+    uint8_t round;
+    uint8_t posn;
+    uint8_t state1[16];
+    uint8_t state2[16];
+
+    // Copy the input into the state and reverse the final round key.
+    for (posn = 0; posn < 16; ++posn)
+        state1[posn] = input[posn] ^ roundKey[posn];
+
+    // Perform all other rounds in reverse, two at a time.  The round
+    // keys have already had InvMixColumns applied by invKeySchedule().
+    for (round = rounds; round > 2; round -= 2) {
+        roundKey -= 16;
+        inverseRound(state2, state1, roundKey);
+        roundKey -= 16;
+        inverseRound(state1, state2, roundKey);
+    }
+    roundKey -= 16;
+    inverseRound(state2, state1, roundKey);
+
+    // Reverse the initial round and create the output words.
+    inverseShiftRowsAndSubBytes(state1, state2);
+    roundKey -= 16;
+    for (posn = 0; posn < 16; ++posn)
+        output[posn] = state1[posn] ^ roundKey[posn];
+#else
     const uint8_t *roundKey = schedule + rounds * 16;
     uint8_t round;
     uint8_t posn;
@@ -327,15 +507,108 @@ void AESCommon::decryptBlock(uint8_t *output, const uint8_t *input)
     roundKey -= 16;
     for (posn = 0; posn < 16; ++posn)
         output[posn] = state2[posn] ^ roundKey[posn];
+#endif
+}
+
+void AESCommon::encryptBlocks(uint8_t *output, const uint8_t *input, size_t count)
+{
+#if defined(CRYPTO_AES_HW)
+    if (hwAvailable()) {
+        hwEncryptBlocks(schedule, rounds, output, input, count);
+        return;
+    }
+#endif
+
+#if defined(CRYPTO_AES_BITSLICED)
+    bsEncryptBlocks(bitsliced, rounds, output, input, count);
+#else
+    BlockCipher::encryptBlocks(output, input, count);
+#endif
+}
+
+void AESCommon::decryptBlocks(uint8_t *output, const uint8_t *input, size_t count)
+{
+#if defined(CRYPTO_AES_HW)
+    if (hwAvailable()) {
+        hwDecryptBlocks(invSchedule, rounds, output, input, count);
+        return;
+    }
+#endif
+
+#if defined(CRYPTO_AES_BITSLICED)
+    bsDecryptBlocks(bitsliced, rounds, output, input, count);
+#else
+    BlockCipher::decryptBlocks(output, input, count);
+#endif
 }
 
 void AESCommon::clear()
 {
     clean(schedule, (rounds + 1) * 16);
+#if defined(CRYPTO_AES_BITSLICED)
+    clean(bitsliced, (rounds + 1) * 8 * sizeof(uint64_t));
+#endif
+#if defined(CRYPTO_AES_INV_ROUND_KEYS)
+    clean(invSchedule, (rounds + 1) * 16);
+#endif
 }
 
 /** @cond aes_keycore */
 
+#if defined(CRYPTO_AES_INV_SCHEDULE)
+
+void AESCommon::invKeySchedule(uint8_t *invSchedule, const uint8_t *schedule,
+                               uint8_t rounds)
+{
+    // The first and last round keys are used as-is.  The middle round keys
+    // have InvMixColumns applied so that AddRoundKey can be moved after
+    // InvMixColumns in the decryption rounds (FIPS 197, section 5.3.5).
+    uint8_t posn;
+    memcpy(invSchedule, schedule, 16);
+    for (posn = 16; posn < rounds * 16; posn += 4)
+        inverseMixColumn(invSchedule + posn, schedule + posn);
+    memcpy(invSchedule + rounds * 16, schedule + rounds * 16, 16);
+}
+
+#endif
+
+#if defined(CRYPTO_AES_HW) || defined(CRYPTO_AES_BITSLICED)
+
+void AESCommon::expandKey(uint8_t *schedule, const uint8_t *key,
+                          uint8_t keyWords, uint8_t rounds,
+                          uint32_t (*subWord)(uint32_t word))
+{
+    // Expand the key one 32-bit word at a time as described in FIPS 197,
+    // using a constant-time SubWord() supplied by the caller.  Words are
+    // little-endian so RotWord() is a right rotation by 8 bits and the
+    // round constant goes into the low byte.
+    uint32_t w[60];
+    uint8_t total = (rounds + 1) * 4;
+    uint8_t rcon = 0x01;
+    uint32_t temp;
+    uint8_t i;
+    memcpy(w, key, keyWords * 4);
+    for (i = 0; i < keyWords; ++i)
+        w[i] = le32toh(w[i]);
+    for (i = keyWords; i < total; ++i) {
+        temp = w[i - 1];
+        if ((i % keyWords) == 0) {
+            temp = subWord((temp >> 8) | (temp << 24)) ^ rcon;
+            rcon = (rcon << 1) ^ (0x1B & -(rcon >> 7));
+        } else if (keyWords > 6 && (i % keyWords) == 4) {
+            temp = subWord(temp);
+        }
+        w[i] = w[i - keyWords] ^ temp;
+    }
+    for (i = 0; i < total; ++i)
+        w[i] = htole32(w[i]);
+    memcpy(schedule, w, total * 4);
+    clean(w);
+    clean(temp);
+}
+
+#endif
+
 void AESCommon::keyScheduleCore(uint8_t *output, const uint8_t *input, uint8_t iteration)
 {
     // Rcon(i), 2^i in the Rijndael finite field, for i = 0..10.
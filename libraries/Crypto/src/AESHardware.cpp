@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "AES.h"
+#include "Crypto.h"
+#include <string.h>
+
+// AES implementation using the AES instructions of the host CPU:
+// AES-NI on x86 and the Cryptography Extensions on ARMv8.  The functions
+// here are only called by AESCommon after hwAvailable() returns true.
+// The key schedule has the same layout as the one created by the portable
+// code, so both implementations can share it.  The inverse schedule holds
+// the round keys for the equivalent inverse cipher in the same layout as
+// AESCommon::invKeySchedule() creates.
+
+#if defined(CRYPTO_AES_HW)
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#define CRYPTO_AES_HW_TARGET __attribute__((target("aes,sse2")))
+#else
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#include <arm_neon.h>
+#define CRYPTO_AES_HW_TARGET
+#endif
+
+/** @cond aes_hw */
+
+bool AESCommon::hwAvailable()
+{
+    // -1 until the CPU has been probed, then 0 or 1.
+    static int available = -1;
+    if (available < 0) {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned eax, ebx, ecx, edx;
+        available = (__get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+                     (ecx & bit_AES) != 0 && (edx & bit_SSE2) != 0);
+#else
+        available = (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+#endif
+    }
+    return available != 0;
+}
+
+// Applies the S-box to the four bytes of a word with the AES instructions.
+// The four columns of the state are all set to the word so that ShiftRows
+// has no effect and we are left with SubWord().
+CRYPTO_AES_HW_TARGET static uint32_t subWord(uint32_t word)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    // AESENCLAST with a zero round key is ShiftRows followed by SubBytes.
+    __m128i x = _mm_set1_epi32((int)word);
+    x = _mm_aesenclast_si128(x, _mm_setzero_si128());
+    return (uint32_t)_mm_cvtsi128_si32(x);
+#else
+    // AESE with a zero round key is SubBytes followed by ShiftRows.
+    uint8x16_t x = vreinterpretq_u8_u32(vdupq_n_u32(word));
+    x = vaeseq_u8(x, vdupq_n_u8(0));
+    return vgetq_lane_u32(vreinterpretq_u32_u8(x), 0);
+#endif
+}
+
+CRYPTO_AES_HW_TARGET void AESCommon::hwKeySchedule
+    (uint8_t *schedule, uint8_t *invSchedule, const uint8_t *key,
+     uint8_t keyWords, uint8_t rounds)
+{
+    expandKey(schedule, key, keyWords, rounds, subWord);
+
+    // The equivalent inverse cipher needs InvMixColumns applied to the
+    // middle round keys.  Do that once here rather than for every block.
+    memcpy(invSchedule, schedule, 16);
+    for (uint8_t round = 1; round < rounds; ++round) {
+#if defined(__x86_64__) || defined(__i386__)
+        __m128i k = _mm_loadu_si128((const __m128i *)(schedule + round * 16));
+        _mm_storeu_si128((__m128i *)(invSchedule + round * 16),
+                         _mm_aesimc_si128(k));
+#else
+        uint8x16_t k = vld1q_u8(schedule + round * 16);
+        vst1q_u8(invSchedule + round * 16, vaesimcq_u8(k));
+#endif
+    }
+    memcpy(invSchedule + rounds * 16, schedule + rounds * 16, 16);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+CRYPTO_AES_HW_TARGET void AESCommon::hwEncryptBlock
+    (const uint8_t *schedule, uint8_t rounds, uint8_t *output, const uint8_t *input)
+{
+    const __m128i *rk = (const __m128i *)schedule;
+    __m128i s = _mm_loadu_si128((const __m128i *)input);
+    s = _mm_xor_si128(s, _mm_loadu_si128(rk));
+    for (uint8_t round = 1; round < rounds; ++round)
+        s = _mm_aesenc_si128(s, _mm_loadu_si128(rk + round));
+    s = _mm_aesenclast_si128(s, _mm_loadu_si128(rk + rounds));
+    _mm_storeu_si128((__m128i *)output, s);
+}
+
+CRYPTO_AES_HW_TARGET void AESCommon::hwDecryptBlock
+    (const uint8_t *invSchedule, uint8_t rounds, uint8_t *output,
+     const uint8_t *input)
+{
+    const __m128i *rk = (const __m128i *)invSchedule;
+    __m128i s = _mm_loadu_si128((const __m128i *)input);
+    s = _mm_xor_si128(s, _mm_loadu_si128(rk + rounds));
+    for (uint8_t round = rounds - 1; round > 0; --round)
+        s = _mm_aesdec_si128(s, _mm_loadu_si128(rk + round));
+    s = _mm_aesdeclast_si128(s, _mm_loadu_si128(rk));
+    _mm_storeu_si128((__m128i *)output, s);
+}
+
+CRYPTO_AES_HW_TARGET void AESCommon::hwEncryptBlocks
+    (const uint8_t *schedule, uint8_t rounds, uint8_t *output,
+     const uint8_t *input, size_t count)
+{
+    // Interleave four blocks at a time to hide the latency of AESENC.
+    const __m128i *rk = (const __m128i *)schedule;
+    const __m128i *in = (const __m128i *)input;
+    __m128i *out = (__m128i *)output;
+    for (; count >= 4; count -= 4, in += 4, out += 4) {
+        __m128i k = _mm_loadu_si128(rk);
+        __m128i s0 = _mm_xor_si128(_mm_loadu_si128(in), k);
+        __m128i s1 = _mm_xor_si128(_mm_loadu_si128(in + 1), k);
+        __m128i s2 = _mm_xor_si128(_mm_loadu_si128(in + 2), k);
+        __m128i s3 = _mm_xor_si128(_mm_loadu_si128(in + 3), k);
+        for (uint8_t round = 1; round < rounds; ++round) {
+            k = _mm_loadu_si128(rk + round);
+            s0 = _mm_aesenc_si128(s0, k);
+            s1 = _mm_aesenc_si128(s1, k);
+            s2 = _mm_aesenc_si128(s2, k);
+            s3 = _mm_aesenc_si128(s3, k);
+        }
+        k = _mm_loadu_si128(rk + rounds);
+        _mm_storeu_si128(out, _mm_aesenclast_si128(s0, k));
+        _mm_storeu_si128(out + 1, _mm_aesenclast_si128(s1, k));
+        _mm_storeu_si128(out + 2, _mm_aesenclast_si128(s2, k));
+        _mm_storeu_si128(out + 3, _mm_aesenclast_si128(s3, k));
+    }
+    for (; count > 0; --count, ++in, ++out)
+        hwEncryptBlock(schedule, rounds, (uint8_t *)out, (const uint8_t *)in);
+}
+
+CRYPTO_AES_HW_TARGET void AESCommon::hwDecryptBlocks
+    (const uint8_t *invSchedule, uint8_t rounds, uint8_t *output,
+     const uint8_t *input, size_t count)
+{
+    const __m128i *rk = (const __m128i *)invSchedule;
+    const __m128i *in = (const __m128i *)input;
+    __m128i *out = (__m128i *)output;
+    for (; count >= 4; count -= 4, in += 4, out += 4) {
+        __m128i k = _mm_loadu_si128(rk + rounds);
+        __m128i s0 = _mm_xor_si128(_mm_loadu_si128(in), k);
+        __m128i s1 = _mm_xor_si128(_mm_loadu_si128(in + 1), k);
+        __m128i s2 = _mm_xor_si128(_mm_loadu_si128(in + 2), k);
+        __m128i s3 = _mm_xor_si128(_mm_loadu_si128(in + 3), k);
+        for (uint8_t round = rounds - 1; round > 0; --round) {
+            k = _mm_loadu_si128(rk + round);
+            s0 = _mm_aesdec_si128(s0, k);
+            s1 = _mm_aesdec_si128(s1, k);
+            s2 = _mm_aesdec_si128(s2, k);
+            s3 = _mm_aesdec_si128(s3, k);
+        }
+        k = _mm_loadu_si128(rk);
+        _mm_storeu_si128(out, _mm_aesdeclast_si128(s0, k));
+        _mm_storeu_si128(out + 1, _mm_aesdeclast_si128(s1, k));
+        _mm_storeu_si128(out + 2, _mm_aesdeclast_si128(s2, k));
+        _mm_storeu_si128(out + 3, _mm_aesdeclast_si128(s3, k));
+    }
+    for (; count > 0; --count, ++in, ++out)
+        hwDecryptBlock(invSchedule, rounds, (uint8_t *)out, (const uint8_t *)in);
+}
+
+#else // ARMv8
+
+void AESCommon::hwEncryptBlock
+    (const uint8_t *schedule, uint8_t rounds, uint8_t *output, const uint8_t *input)
+{
+    // AESE performs AddRoundKey before SubBytes and ShiftRows, so the
+    // last round key is XOR'ed in separately at the end.
+    uint8x16_t s = vld1q_u8(input);
+    for (uint8_t round = 0; round < (rounds - 1); ++round)
+        s = vaesmcq_u8(vaeseq_u8(s, vld1q_u8(schedule + round * 16)));
+    s = vaeseq_u8(s, vld1q_u8(schedule + (rounds - 1) * 16));
+    s = veorq_u8(s, vld1q_u8(schedule + rounds * 16));
+    vst1q_u8(output, s);
+}
+
+void AESCommon::hwDecryptBlock
+    (const uint8_t *invSchedule, uint8_t rounds, uint8_t *output,
+     const uint8_t *input)
+{
+    uint8x16_t s = vld1q_u8(input);
+    s = vaesdq_u8(s, vld1q_u8(invSchedule + rounds * 16));
+    for (uint8_t round = rounds - 1; round > 0; --round) {
+        s = vaesimcq_u8(s);
+        s = vaesdq_u8(s, vld1q_u8(invSchedule + round * 16));
+    }
+    s = veorq_u8(s, vld1q_u8(invSchedule));
+    vst1q_u8(output, s);
+}
+
+
+void AESCommon::hwEncryptBlocks
+    (const uint8_t *schedule, uint8_t rounds, uint8_t *output,
+     const uint8_t *input, size_t count)
+{
+    // Interleave four blocks at a time to hide the latency of AESE.
+    for (; count >= 4; count -= 4, input += 64, output += 64) {
+        uint8x16_t s0 = vld1q_u8(input);
+        uint8x16_t s1 = vld1q_u8(input + 16);
+        uint8x16_t s2 = vld1q_u8(input + 32);
+        uint8x16_t s3 = vld1q_u8(input + 48);
+        uint8x16_t k;
+        for (uint8_t round = 0; round < (rounds - 1); ++round) {
+            k = vld1q_u8(schedule + round * 16);
+            s0 = vaesmcq_u8(vaeseq_u8(s0, k));
+            s1 = vaesmcq_u8(vaeseq_u8(s1, k));
+            s2 = vaesmcq_u8(vaeseq_u8(s2, k));
+            s3 = vaesmcq_u8(vaeseq_u8(s3, k));
+        }
+        k = vld1q_u8(schedule + (rounds - 1) * 16);
+        s0 = vaeseq_u8(s0, k);
+        s1 = vaeseq_u8(s1, k);
+        s2 = vaeseq_u8(s2, k);
+        s3 = vaeseq_u8(s3, k);
+        k = vld1q_u8(schedule + rounds * 16);
+        vst1q_u8(output, veorq_u8(s0, k));
+        vst1q_u8(output + 16, veorq_u8(s1, k));
+        vst1q_u8(output + 32, veorq_u8(s2, k));
+        vst1q_u8(output + 48, veorq_u8(s3, k));
+    }
+    for (; count > 0; --count, input += 16, output += 16)
+        hwEncryptBlock(schedule, rounds, output, input);
+}
+
+void AESCommon::hwDecryptBlocks
+    (const uint8_t *invSchedule, uint8_t rounds, uint8_t *output,
+     const uint8_t *input, size_t count)
+{
+    for (; count >= 4; count -= 4, input += 64, output += 64) {
+        uint8x16_t k = vld1q_u8(invSchedule + rounds * 16);
+        uint8x16_t s0 = vaesdq_u8(vld1q_u8(input), k);
+        uint8x16_t s1 = vaesdq_u8(vld1q_u8(input + 16), k);
+        uint8x16_t s2 = vaesdq_u8(vld1q_u8(input + 32), k);
+        uint8x16_t s3 = vaesdq_u8(vld1q_u8(input + 48), k);
+        for (uint8_t round = rounds - 1; round > 0; --round) {
+            k = vld1q_u8(invSchedule + round * 16);
+            s0 = vaesdq_u8(vaesimcq_u8(s0), k);
+            s1 = vaesdq_u8(vaesimcq_u8(s1), k);
+            s2 = vaesdq_u8(vaesimcq_u8(s2), k);
+            s3 = vaesdq_u8(vaesimcq_u8(s3), k);
+        }
+        k = vld1q_u8(invSchedule);
+        vst1q_u8(output, veorq_u8(s0, k));
+        vst1q_u8(output + 16, veorq_u8(s1, k));
+        vst1q_u8(output + 32, veorq_u8(s2, k));
+        vst1q_u8(output + 48, veorq_u8(s3, k));
+    }
+    for (; count > 0; --count, input += 16, output += 16)
+        hwDecryptBlock(invSchedule, rounds, output, input);
+}
+
+#endif
+
+/** @endcond */
+
+#endif // CRYPTO_AES_HW
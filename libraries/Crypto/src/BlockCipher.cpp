@@ -112,6 +112,59 @@ BlockCipher::~BlockCipher()
  * \sa encryptBlock(), blockSize()
  */
 
+/**
+ * \brief Encrypts several consecutive blocks using this cipher.
+ *
+ * \param output The output buffer to put the ciphertext into.
+ * Must be at least \a count * blockSize() bytes in length.
+ * \param input The input buffer to read the plaintext from which is
+ * allowed to be the same as \a output.  Must be at least
+ * \a count * blockSize() bytes in length.
+ * \param count The number of blocks to encrypt.
+ *
+ * The default implementation calls encryptBlock() for each block in turn.
+ * Subclasses can override this to encrypt several blocks in parallel.
+ * Modes such as CTR, GCM, EAX, and XTS call this function when they have
+ * more than one block to encrypt at a time.
+ *
+ * \sa decryptBlocks(), encryptBlock()
+ */
+void BlockCipher::encryptBlocks(uint8_t *output, const uint8_t *input, size_t count)
+{
+    size_t size = blockSize();
+    while (count > 0) {
+        encryptBlock(output, input);
+        output += size;
+        input += size;
+        --count;
+    }
+}
+
+/**
+ * \brief Decrypts several consecutive blocks using this cipher.
+ *
+ * \param output The output buffer to put the plaintext into.
+ * Must be at least \a count * blockSize() bytes in length.
+ * \param input The input buffer to read the ciphertext from which is
+ * allowed to be the same as \a output.  Must be at least
+ * \a count * blockSize() bytes in length.
+ * \param count The number of blocks to decrypt.
+ *
+ * The default implementation calls decryptBlock() for each block in turn.
+ *
+ * \sa encryptBlocks(), decryptBlock()
+ */
+void BlockCipher::decryptBlocks(uint8_t *output, const uint8_t *input, size_t count)
+{
+    size_t size = blockSize();
+    while (count > 0) {
+        decryptBlock(output, input);
+        output += size;
+        input += size;
+        --count;
+    }
+}
+
 /**
  * \fn void BlockCipher::clear()
  * \brief Clears all security-sensitive state from this block cipher.
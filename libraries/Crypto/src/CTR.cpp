@@ -125,26 +125,83 @@ bool CTRCommon::setIV(const uint8_t *iv, size_t len)
     return true;
 }
 
+// Number of counter blocks to encrypt at once with encryptBlocks().
+// Larger batches keep wide hardware and bit-sliced implementations
+// busy but cost more stack, so stick with 4 on AVR.
+#if defined(__AVR__)
+#define CTR_BATCH_BLOCKS 4
+#else
+#define CTR_BATCH_BLOCKS 8
+#endif
+
+// Increment the counter, taking care not to reveal any timing
+// information about the starting value.  We iterate through the
+// entire counter region even if we could stop earlier because a
+// byte is non-zero.
+static inline void increment(uint8_t counter[16], uint8_t counterStart)
+{
+    uint16_t temp = 1;
+    uint8_t index = 16;
+    while (index > counterStart) {
+        --index;
+        temp += counter[index];
+        counter[index] = (uint8_t)temp;
+        temp >>= 8;
+    }
+}
+
+// XOR the input with the keystream, a 64-bit word at a time on
+// platforms where that is cheaper than byte-at-a-time.
+static inline void xorKeystream(uint8_t *output, const uint8_t *input,
+                                const uint8_t *keystream, size_t len)
+{
+#if !defined(__AVR__)
+    while (len >= 8) {
+        uint64_t x, y;
+        memcpy(&x, input, 8);
+        memcpy(&y, keystream, 8);
+        x ^= y;
+        memcpy(output, &x, 8);
+        input += 8;
+        output += 8;
+        keystream += 8;
+        len -= 8;
+    }
+#endif
+    while (len > 0) {
+        *output++ = *input++ ^ *keystream++;
+        --len;
+    }
+}
+
 void CTRCommon::encrypt(uint8_t *output, const uint8_t *input, size_t len)
 {
+    uint8_t blocks[CTR_BATCH_BLOCKS * 16];
+    bool batched = false;
     while (len > 0) {
+        if (posn >= 16 && len >= 16) {
+            // Generate the keystream for several whole blocks at once
+            // so that the block cipher can process them in parallel.
+            size_t count = len / 16;
+            if (count > CTR_BATCH_BLOCKS)
+                count = CTR_BATCH_BLOCKS;
+            for (size_t index = 0; index < count; ++index) {
+                memcpy(blocks + index * 16, counter, 16);
+                increment(counter, counterStart);
+            }
+            blockCipher->encryptBlocks(blocks, blocks, count);
+            xorKeystream(output, input, blocks, count * 16);
+            input += count * 16;
+            output += count * 16;
+            len -= count * 16;
+            batched = true;
+            continue;
+        }
         if (posn >= 16) {
             // Generate a new encrypted counter block.
             blockCipher->encryptBlock(state, counter);
             posn = 0;
-
-            // Increment the counter, taking care not to reveal
-            // any timing information about the starting value.
-            // We iterate through the entire counter region even
-            // if we could stop earlier because a byte is non-zero.
-            uint16_t temp = 1;
-            uint8_t index = 16;
-            while (index > counterStart) {
-                --index;
-                temp += counter[index];
-                counter[index] = (uint8_t)temp;
-                temp >>= 8;
-            }
+            increment(counter, counterStart);
         }
         uint8_t templen = 16 - posn;
         if (templen > len)
@@ -155,6 +212,8 @@ void CTRCommon::encrypt(uint8_t *output, const uint8_t *input, size_t len)
             --templen;
         }
     }
+    if (batched)
+        clean(blocks);
 }
 
 void CTRCommon::decrypt(uint8_t *output, const uint8_t *input, size_t len)
@@ -36,6 +36,12 @@
  * Variations on the ChaCha cipher use 8, 12, or 20 rounds of hashing
  * operations with either 128-bit or 256-bit keys.
  *
+ * On x86 and ARM hosts with SIMD instructions, calls to encrypt() that
+ * cover at least 256 bytes generate four (SSE2 or NEON) or eight (AVX2)
+ * keystream blocks at once.  The instructions are detected at runtime on
+ * x86.  The output is identical to the portable code.  Define
+ * CRYPTO_NO_CHACHA_SIMD when compiling the library to disable this.
+ *
  * Reference: http://cr.yp.to/chacha.html
  */
 
@@ -159,6 +165,20 @@ void ChaCha::encrypt(uint8_t *output, const uint8_t *input, size_t len)
 {
     while (len > 0) {
         if (posn >= 64) {
+#if defined(CRYPTO_CHACHA_SIMD)
+            // Encrypt as many whole blocks as possible with the SIMD
+            // instructions of the CPU if the request is long enough.
+            if (len >= 256) {
+                size_t done = simdEncrypt(output, input, len);
+                if (done) {
+                    output += done;
+                    input += done;
+                    len -= done;
+                    continue;
+                }
+            }
+#endif
+
             // Generate a new encrypted counter block.
             hashCore((uint32_t *)stream, (const uint32_t *)block, rounds);
             posn = 0;
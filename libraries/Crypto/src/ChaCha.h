@@ -25,6 +25,18 @@
 
 #include "Cipher.h"
 
+// Determine if the host CPU may have SIMD instructions for generating
+// several keystream blocks at once: SSE2 and AVX2 on x86, NEON on ARM.
+// Define CRYPTO_NO_CHACHA_SIMD to always use the portable implementation.
+#if !defined(CRYPTO_NO_CHACHA_SIMD) && defined(__GNUC__)
+#if defined(__x86_64__) || defined(__i386__)
+#define CRYPTO_CHACHA_SIMD 1
+#elif (defined(__aarch64__) || defined(__ARM_NEON)) && \
+      defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define CRYPTO_CHACHA_SIMD 1
+#endif
+#endif
+
 class ChaChaPoly;
 
 class ChaCha : public Cipher
@@ -57,6 +69,9 @@ private:
     uint8_t posn;
 
     void keystreamBlock(uint32_t *output);
+#if defined(CRYPTO_CHACHA_SIMD)
+    size_t simdEncrypt(uint8_t *output, const uint8_t *input, size_t len);
+#endif
 
     friend class ChaChaPoly;
 };
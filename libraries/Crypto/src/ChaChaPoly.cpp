@@ -25,6 +25,11 @@
 #include "utility/EndianUtil.h"
 #include <string.h>
 
+// Number of bytes to encrypt and authenticate at a time in seal() and open().
+// This is a multiple of the ChaCha block size, and is large enough for the
+// multi-block ChaCha and Poly1305 code paths on hosts that have them.
+#define CHACHAPOLY_ONESHOT_CHUNK 2048
+
 /**
  * \class ChaChaPoly ChaChaPoly.h <ChaChaPoly.h>
  * \brief Authenticated cipher based on ChaCha and Poly1305
@@ -34,6 +39,11 @@
  * The resulting cipher has a 256-bit key, a 64-bit or 96-bit
  * initialization vector, and a 128-bit authentication tag.
  *
+ * For encrypting whole messages, the static seal() and open() functions
+ * are simpler and faster than creating a ChaChaPoly object.  They avoid
+ * the virtual calls and authenticate each chunk of the message while it
+ * is still in the cache from being encrypted or decrypted.
+ *
  * Reference: https://tools.ietf.org/html/draft-irtf-cfrg-chacha20-poly1305-10
  *
  * \sa ChaCha, Poly1305, AuthenticatedCipher
@@ -168,3 +178,137 @@ void ChaChaPoly::clear()
     clean(state);
     state.ivSize = 8;
 }
+
+/**
+ * \brief Encrypts and authenticates a whole message in one call.
+ *
+ * \param key Points to the 32-byte key.
+ * \param nonce Points to the 12-byte nonce, which must never be reused
+ * with the same key.
+ * \param ad Points to the associated data to authenticate, which may be
+ * NULL if \a adLen is zero.
+ * \param adLen The length of the associated data in bytes.
+ * \param plaintext Points to the plaintext to encrypt.
+ * \param ciphertext Points to the buffer to receive the ciphertext, which
+ * may be the same as \a plaintext.
+ * \param len The number of bytes to encrypt.
+ * \param tag Points to the buffer to receive the 16-byte tag.
+ *
+ * The result is the same as the following sequence, but the message is
+ * processed in a single pass with no virtual calls:
+ *
+ * \code
+ * ChaChaPoly cipher;
+ * cipher.setKey(key, 32);
+ * cipher.setIV(nonce, 12);
+ * cipher.addAuthData(ad, adLen);
+ * cipher.encrypt(ciphertext, plaintext, len);
+ * cipher.computeTag(tag, 16);
+ * \endcode
+ *
+ * \sa open()
+ */
+void ChaChaPoly::seal(const uint8_t *key, const uint8_t *nonce,
+                      const void *ad, size_t adLen,
+                      const uint8_t *plaintext, uint8_t *ciphertext,
+                      size_t len, uint8_t *tag)
+{
+    ChaCha chacha;
+    Poly1305 poly1305;
+    uint8_t polyNonce[16];
+    size_t posn, size;
+
+    startOneShot(chacha, poly1305, polyNonce, key, nonce, ad, adLen);
+    for (posn = 0; posn < len; posn += size) {
+        size = len - posn;
+        if (size > CHACHAPOLY_ONESHOT_CHUNK)
+            size = CHACHAPOLY_ONESHOT_CHUNK;
+        chacha.encrypt(ciphertext + posn, plaintext + posn, size);
+        poly1305.update(ciphertext + posn, size);
+    }
+    finishOneShot(poly1305, polyNonce, adLen, len, tag);
+    clean(polyNonce);
+}
+
+/**
+ * \brief Decrypts and verifies a whole message in one call.
+ *
+ * \param key Points to the 32-byte key.
+ * \param nonce Points to the 12-byte nonce.
+ * \param ad Points to the associated data to authenticate, which may be
+ * NULL if \a adLen is zero.
+ * \param adLen The length of the associated data in bytes.
+ * \param ciphertext Points to the ciphertext to decrypt.
+ * \param plaintext Points to the buffer to receive the plaintext, which
+ * may be the same as \a ciphertext.
+ * \param len The number of bytes to decrypt.
+ * \param tag Points to the 16-byte tag to verify.
+ *
+ * \return Returns true if the tag is valid, or false if it is not.  If the
+ * tag is not valid, then the \a plaintext buffer is cleared so that the
+ * unauthenticated data cannot be used by mistake.
+ *
+ * \sa seal()
+ */
+bool ChaChaPoly::open(const uint8_t *key, const uint8_t *nonce,
+                      const void *ad, size_t adLen,
+                      const uint8_t *ciphertext, uint8_t *plaintext,
+                      size_t len, const uint8_t *tag)
+{
+    ChaCha chacha;
+    Poly1305 poly1305;
+    uint8_t polyNonce[16];
+    uint8_t computed[16];
+    size_t posn, size;
+
+    startOneShot(chacha, poly1305, polyNonce, key, nonce, ad, adLen);
+    for (posn = 0; posn < len; posn += size) {
+        size = len - posn;
+        if (size > CHACHAPOLY_ONESHOT_CHUNK)
+            size = CHACHAPOLY_ONESHOT_CHUNK;
+        poly1305.update(ciphertext + posn, size);
+        chacha.encrypt(plaintext + posn, ciphertext + posn, size);
+    }
+    finishOneShot(poly1305, polyNonce, adLen, len, computed);
+    bool equal = secure_compare(computed, tag, 16);
+    if (!equal)
+        clean(plaintext, len);
+    clean(polyNonce);
+    clean(computed);
+    return equal;
+}
+
+/**
+ * \brief Sets up the ChaCha and Poly1305 state for seal() or open() and
+ * authenticates the associated data.
+ */
+void ChaChaPoly::startOneShot(ChaCha &chacha, Poly1305 &poly1305,
+                              uint8_t *polyNonce, const uint8_t *key,
+                              const uint8_t *nonce, const void *ad,
+                              size_t adLen)
+{
+    uint32_t data[16];
+    chacha.setKey(key, 32);
+    chacha.setIV(nonce, 12);
+    chacha.keystreamBlock(data);
+    poly1305.reset(data);
+    memcpy(polyNonce, data + 4, 16);
+    clean(data);
+    poly1305.update(ad, adLen);
+    poly1305.pad();
+}
+
+/**
+ * \brief Authenticates the sizes and computes the tag for seal() or open().
+ */
+void ChaChaPoly::finishOneShot(Poly1305 &poly1305, const uint8_t *polyNonce,
+                               size_t adLen, size_t len, uint8_t *tag)
+{
+    uint64_t sizes[2];
+    poly1305.pad();
+    sizes[0] = htole64((uint64_t)adLen);
+    sizes[1] = htole64((uint64_t)len);
+    poly1305.update(sizes, sizeof(sizes));
+    poly1305.finalize(polyNonce, tag, 16);
+    clean(sizes);
+}
@@ -50,6 +50,15 @@ public:
 
     void clear();
 
+    static void seal(const uint8_t *key, const uint8_t *nonce,
+                     const void *ad, size_t adLen,
+                     const uint8_t *plaintext, uint8_t *ciphertext,
+                     size_t len, uint8_t *tag);
+    static bool open(const uint8_t *key, const uint8_t *nonce,
+                     const void *ad, size_t adLen,
+                     const uint8_t *ciphertext, uint8_t *plaintext,
+                     size_t len, const uint8_t *tag);
+
 private:
     ChaCha chacha;
     Poly1305 poly1305;
@@ -60,6 +69,13 @@ private:
         bool dataStarted;
         uint8_t ivSize;
     } state;
+
+    static void startOneShot(ChaCha &chacha, Poly1305 &poly1305,
+                             uint8_t *polyNonce, const uint8_t *key,
+                             const uint8_t *nonce, const void *ad,
+                             size_t adLen);
+    static void finishOneShot(Poly1305 &poly1305, const uint8_t *polyNonce,
+                              size_t adLen, size_t len, uint8_t *tag);
 };
 
 #endif
@@ -0,0 +1,367 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ChaCha.h"
+#include "Crypto.h"
+#include "utility/EndianUtil.h"
+#include <string.h>
+
+// Multi-block ChaCha keystream generation using the SIMD instructions of
+// the host CPU: SSE2 and AVX2 on x86, and NEON on ARM.  Each vector holds
+// the same state word for four or eight consecutive blocks, so the blocks
+// are hashed in parallel with the same quarter rounds as hashCore().  The
+// results are then transposed back into blocks and XOR'ed with the input.
+
+#if defined(CRYPTO_CHACHA_SIMD)
+
+/** @cond chacha_simd */
+
+// Perform a ChaCha quarter round operation on four or eight blocks using
+// the ADD, XOR, and ROTL macros for the current instruction set.
+#define quarterRound(a, b, c, d)    \
+    do { \
+        (a) = ADD((a), (b)); \
+        (d) = ROTL(XOR((d), (a)), 16); \
+        (c) = ADD((c), (d)); \
+        (b) = ROTL(XOR((b), (c)), 12); \
+        (a) = ADD((a), (b)); \
+        (d) = ROTL(XOR((d), (a)), 8); \
+        (c) = ADD((c), (d)); \
+        (b) = ROTL(XOR((b), (c)), 7); \
+    } while (0)
+
+// Perform a ChaCha column round and diagonal round on the state words.
+#define doubleRound(x)  \
+    do { \
+        quarterRound((x)[0], (x)[4], (x)[8],  (x)[12]); \
+        quarterRound((x)[1], (x)[5], (x)[9],  (x)[13]); \
+        quarterRound((x)[2], (x)[6], (x)[10], (x)[14]); \
+        quarterRound((x)[3], (x)[7], (x)[11], (x)[15]); \
+        quarterRound((x)[0], (x)[5], (x)[10], (x)[15]); \
+        quarterRound((x)[1], (x)[6], (x)[11], (x)[12]); \
+        quarterRound((x)[2], (x)[7], (x)[8],  (x)[13]); \
+        quarterRound((x)[3], (x)[4], (x)[9],  (x)[14]); \
+    } while (0)
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#define CRYPTO_CHACHA_SSE2_TARGET __attribute__((target("sse2")))
+#define CRYPTO_CHACHA_AVX2_TARGET __attribute__((target("avx2")))
+
+// Returns 2 if the CPU has AVX2, 1 if it only has SSE2, or 0 for neither.
+static int simdLevel()
+{
+    // -1 until the CPU has been probed.  __builtin_cpu_supports() also
+    // checks that the operating system saves the AVX registers.
+    static int level = -1;
+    if (level < 0) {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            level = 2;
+        else if (__builtin_cpu_supports("sse2"))
+            level = 1;
+        else
+            level = 0;
+    }
+    return level;
+}
+
+#define ADD(a, b)       _mm_add_epi32((a), (b))
+#define XOR(a, b)       _mm_xor_si128((a), (b))
+#define ROTL(a, n)      _mm_or_si128(_mm_slli_epi32((a), (n)), \
+                                     _mm_srli_epi32((a), 32 - (n)))
+
+// Transposes four state words for four blocks, XOR's them with the input,
+// and writes the result to the output.  "offset" is the byte offset of the
+// first word within each 64-byte block.
+CRYPTO_CHACHA_SSE2_TARGET static inline void output4
+    (uint8_t *output, const uint8_t *input, __m128i a, __m128i b,
+     __m128i c, __m128i d, uint8_t offset)
+{
+    __m128i t0 = _mm_unpacklo_epi32(a, b);
+    __m128i t1 = _mm_unpacklo_epi32(c, d);
+    __m128i t2 = _mm_unpackhi_epi32(a, b);
+    __m128i t3 = _mm_unpackhi_epi32(c, d);
+    a = _mm_unpacklo_epi64(t0, t1);
+    b = _mm_unpackhi_epi64(t0, t1);
+    c = _mm_unpacklo_epi64(t2, t3);
+    d = _mm_unpackhi_epi64(t2, t3);
+    input += offset;
+    output += offset;
+    _mm_storeu_si128((__m128i *)output, XOR(a, _mm_loadu_si128((const __m128i *)input)));
+    _mm_storeu_si128((__m128i *)(output + 64), XOR(b, _mm_loadu_si128((const __m128i *)(input + 64))));
+    _mm_storeu_si128((__m128i *)(output + 128), XOR(c, _mm_loadu_si128((const __m128i *)(input + 128))));
+    _mm_storeu_si128((__m128i *)(output + 192), XOR(d, _mm_loadu_si128((const __m128i *)(input + 192))));
+}
+
+// Encrypts four blocks starting at the given 64-bit block counter.
+CRYPTO_CHACHA_SSE2_TARGET static void encrypt4
+    (uint8_t *output, const uint8_t *input, const uint32_t *words,
+     uint64_t counter, uint8_t rounds)
+{
+    __m128i s[16];
+    __m128i x[16];
+    uint8_t posn;
+    for (posn = 0; posn < 16; ++posn)
+        s[posn] = _mm_set1_epi32((int)(words[posn]));
+    s[12] = _mm_set_epi32((int)(uint32_t)(counter + 3),
+                          (int)(uint32_t)(counter + 2),
+                          (int)(uint32_t)(counter + 1),
+                          (int)(uint32_t)counter);
+    s[13] = _mm_set_epi32((int)(uint32_t)((counter + 3) >> 32),
+                          (int)(uint32_t)((counter + 2) >> 32),
+                          (int)(uint32_t)((counter + 1) >> 32),
+                          (int)(uint32_t)(counter >> 32));
+    for (posn = 0; posn < 16; ++posn)
+        x[posn] = s[posn];
+    for (; rounds >= 2; rounds -= 2)
+        doubleRound(x);
+    for (posn = 0; posn < 16; ++posn)
+        x[posn] = ADD(x[posn], s[posn]);
+    output4(output, input, x[0],  x[1],  x[2],  x[3],  0);
+    output4(output, input, x[4],  x[5],  x[6],  x[7],  16);
+    output4(output, input, x[8],  x[9],  x[10], x[11], 32);
+    output4(output, input, x[12], x[13], x[14], x[15], 48);
+}
+
+#undef ADD
+#undef XOR
+#undef ROTL
+
+// Rotations by 16 and 8 are byte shuffles, the others need two shifts.
+#define ADD(a, b)       _mm256_add_epi32((a), (b))
+#define XOR(a, b)       _mm256_xor_si256((a), (b))
+#define ROTL(a, n)      \
+    ((n) == 16 ? _mm256_shuffle_epi8((a), rot16) : \
+     (n) == 8  ? _mm256_shuffle_epi8((a), rot8) : \
+     _mm256_or_si256(_mm256_slli_epi32((a), (n)), \
+                     _mm256_srli_epi32((a), 32 - (n))))
+
+// Transposes four state words for eight blocks, XOR's them with the input,
+// and writes the result to the output.  The low 128 bits of each vector are
+// for blocks 0 to 3 and the high 128 bits are for blocks 4 to 7.
+CRYPTO_CHACHA_AVX2_TARGET static inline void transpose8
+    (__m256i &a, __m256i &b, __m256i &c, __m256i &d)
+{
+    __m256i t0 = _mm256_unpacklo_epi32(a, b);
+    __m256i t1 = _mm256_unpacklo_epi32(c, d);
+    __m256i t2 = _mm256_unpackhi_epi32(a, b);
+    __m256i t3 = _mm256_unpackhi_epi32(c, d);
+    a = _mm256_unpacklo_epi64(t0, t1);
+    b = _mm256_unpackhi_epi64(t0, t1);
+    c = _mm256_unpacklo_epi64(t2, t3);
+    d = _mm256_unpackhi_epi64(t2, t3);
+}
+
+// XOR's 32 bytes of keystream with the input and writes it to the output.
+CRYPTO_CHACHA_AVX2_TARGET static inline void output8
+    (uint8_t *output, const uint8_t *input, __m256i x)
+{
+    _mm256_storeu_si256
+        ((__m256i *)output,
+         XOR(x, _mm256_loadu_si256((const __m256i *)input)));
+}
+
+// Encrypts eight blocks starting at the given 64-bit block counter.
+CRYPTO_CHACHA_AVX2_TARGET static void encrypt8
+    (uint8_t *output, const uint8_t *input, const uint32_t *words,
+     uint64_t counter, uint8_t rounds)
+{
+    const __m256i rot16 = _mm256_setr_epi8
+        (2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+         2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8 = _mm256_setr_epi8
+        (3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+         3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+    __m256i s[16];
+    __m256i x[16];
+    uint32_t low[8];
+    uint32_t high[8];
+    uint8_t posn;
+    for (posn = 0; posn < 16; ++posn)
+        s[posn] = _mm256_set1_epi32((int)(words[posn]));
+    for (posn = 0; posn < 8; ++posn) {
+        low[posn] = (uint32_t)(counter + posn);
+        high[posn] = (uint32_t)((counter + posn) >> 32);
+    }
+    s[12] = _mm256_loadu_si256((const __m256i *)low);
+    s[13] = _mm256_loadu_si256((const __m256i *)high);
+    for (posn = 0; posn < 16; ++posn)
+        x[posn] = s[posn];
+    for (; rounds >= 2; rounds -= 2)
+        doubleRound(x);
+    for (posn = 0; posn < 16; ++posn)
+        x[posn] = ADD(x[posn], s[posn]);
+    transpose8(x[0],  x[1],  x[2],  x[3]);
+    transpose8(x[4],  x[5],  x[6],  x[7]);
+    transpose8(x[8],  x[9],  x[10], x[11]);
+    transpose8(x[12], x[13], x[14], x[15]);
+    for (posn = 0; posn < 4; ++posn) {
+        // Block "posn" is in the low halves and block "posn + 4" is
+        // in the high halves of x[posn], x[posn + 4], etc.
+        uint8_t *out = output + posn * 64;
+        const uint8_t *in = input + posn * 64;
+        output8(out, in, _mm256_permute2x128_si256
+                    (x[posn], x[posn + 4], 0x20));
+        output8(out + 32, in + 32, _mm256_permute2x128_si256
+                    (x[posn + 8], x[posn + 12], 0x20));
+        output8(out + 256, in + 256, _mm256_permute2x128_si256
+                    (x[posn], x[posn + 4], 0x31));
+        output8(out + 288, in + 288, _mm256_permute2x128_si256
+                    (x[posn + 8], x[posn + 12], 0x31));
+    }
+}
+
+#undef ADD
+#undef XOR
+#undef ROTL
+
+#else // ARM NEON
+
+#include <arm_neon.h>
+
+#define ADD(a, b)       vaddq_u32((a), (b))
+#define XOR(a, b)       veorq_u32((a), (b))
+#define ROTL(a, n)      \
+    ((n) == 16 ? vreinterpretq_u32_u16(vrev32q_u16(vreinterpretq_u16_u32(a))) : \
+     vsriq_n_u32(vshlq_n_u32((a), (n)), (a), 32 - (n)))
+
+// Transposes four state words for four blocks, XOR's them with the input,
+// and writes the result to the output.  "offset" is the byte offset of the
+// first word within each 64-byte block.
+static inline void output4
+    (uint8_t *output, const uint8_t *input, uint32x4_t a, uint32x4_t b,
+     uint32x4_t c, uint32x4_t d, uint8_t offset)
+{
+    uint32x4x2_t t0 = vtrnq_u32(a, b);
+    uint32x4x2_t t1 = vtrnq_u32(c, d);
+    a = vcombine_u32(vget_low_u32(t0.val[0]), vget_low_u32(t1.val[0]));
+    b = vcombine_u32(vget_low_u32(t0.val[1]), vget_low_u32(t1.val[1]));
+    c = vcombine_u32(vget_high_u32(t0.val[0]), vget_high_u32(t1.val[0]));
+    d = vcombine_u32(vget_high_u32(t0.val[1]), vget_high_u32(t1.val[1]));
+    input += offset;
+    output += offset;
+    vst1q_u8(output, veorq_u8(vreinterpretq_u8_u32(a), vld1q_u8(input)));
+    vst1q_u8(output + 64, veorq_u8(vreinterpretq_u8_u32(b), vld1q_u8(input + 64)));
+    vst1q_u8(output + 128, veorq_u8(vreinterpretq_u8_u32(c), vld1q_u8(input + 128)));
+    vst1q_u8(output + 192, veorq_u8(vreinterpretq_u8_u32(d), vld1q_u8(input + 192)));
+}
+
+// Encrypts four blocks starting at the given 64-bit block counter.
+static void encrypt4
+    (uint8_t *output, const uint8_t *input, const uint32_t *words,
+     uint64_t counter, uint8_t rounds)
+{
+    uint32x4_t s[16];
+    uint32x4_t x[16];
+    uint32_t low[4];
+    uint32_t high[4];
+    uint8_t posn;
+    for (posn = 0; posn < 16; ++posn)
+        s[posn] = vdupq_n_u32(words[posn]);
+    for (posn = 0; posn < 4; ++posn) {
+        low[posn] = (uint32_t)(counter + posn);
+        high[posn] = (uint32_t)((counter + posn) >> 32);
+    }
+    s[12] = vld1q_u32(low);
+    s[13] = vld1q_u32(high);
+    for (posn = 0; posn < 16; ++posn)
+        x[posn] = s[posn];
+    for (; rounds >= 2; rounds -= 2)
+        doubleRound(x);
+    for (posn = 0; posn < 16; ++posn)
+        x[posn] = ADD(x[posn], s[posn]);
+    output4(output, input, x[0],  x[1],  x[2],  x[3],  0);
+    output4(output, input, x[4],  x[5],  x[6],  x[7],  16);
+    output4(output, input, x[8],  x[9],  x[10], x[11], 32);
+    output4(output, input, x[12], x[13], x[14], x[15], 48);
+}
+
+#undef ADD
+#undef XOR
+#undef ROTL
+
+#endif
+
+/**
+ * \brief Encrypts whole blocks with the SIMD instructions of the CPU.
+ *
+ * \param output The output buffer to write to.
+ * \param input The input buffer to read from.
+ * \param len The length of the input, which must be at least 256 bytes.
+ * \return The number of bytes that were encrypted, which is a multiple
+ * of 256, or zero if the CPU does not have the necessary instructions.
+ *
+ * The block counter is advanced past the blocks that were encrypted.
+ * The caller must ensure that there is no left-over keystream in the
+ * "stream" buffer from the previous call.
+ */
+size_t ChaCha::simdEncrypt(uint8_t *output, const uint8_t *input, size_t len)
+{
+    uint32_t words[16];
+    uint64_t counter;
+    size_t done = 0;
+    uint8_t posn;
+
+#if defined(__x86_64__) || defined(__i386__)
+    int level = simdLevel();
+    if (!level)
+        return 0;
+#endif
+
+    // Convert the state into host byte order and extract the counter.
+    memcpy(words, block, 64);
+    for (posn = 0; posn < 16; ++posn)
+        words[posn] = le32toh(words[posn]);
+    counter = words[12] | (((uint64_t)(words[13])) << 32);
+
+    // Encrypt groups of eight blocks with AVX2 and then groups of
+    // four blocks with SSE2 or NEON.
+#if defined(__x86_64__) || defined(__i386__)
+    if (level >= 2) {
+        while ((len - done) >= 512) {
+            encrypt8(output + done, input + done, words, counter, rounds);
+            counter += 8;
+            done += 512;
+        }
+    }
+#endif
+    while ((len - done) >= 256) {
+        encrypt4(output + done, input + done, words, counter, rounds);
+        counter += 4;
+        done += 256;
+    }
+
+    // Write the new counter value back to the state.
+    words[12] = htole32((uint32_t)counter);
+    words[13] = htole32((uint32_t)(counter >> 32));
+    memcpy(block + 48, words + 12, 8);
+    clean(words);
+    return done;
+}
+
+/** @endcond */
+
+#endif // CRYPTO_CHACHA_SIMD
@@ -70,7 +70,13 @@ size_t EAXCommon::tagSize() const
 
 bool EAXCommon::setKey(const uint8_t *key, size_t len)
 {
-    return omac.blockCipher()->setKey(key, len);
+    if (!omac.blockCipher()->setKey(key, len))
+        return false;
+
+    // The OMAC subkeys only depend upon the key, so derive them once here
+    // rather than every time setIV() is called.
+    omac.initKey();
+    return true;
 }
 
 bool EAXCommon::setIV(const uint8_t *iv, size_t len)
@@ -79,8 +85,8 @@ bool EAXCommon::setIV(const uint8_t *iv, size_t len)
     if (!len)
         return false;
 
-    // Hash the IV to create the initial nonce for CTR mode.  Also creates B.
-    omac.initFirst(state.counter);
+    // Hash the IV to create the initial nonce for CTR mode.
+    omac.restartFirst(state.counter);
     omac.update(state.counter, iv, len);
     omac.finalize(state.counter);
 
@@ -101,16 +107,48 @@ void EAXCommon::encrypt(uint8_t *output, const uint8_t *input, size_t len)
 {
     if (state.authMode)
         closeAuthData();
-    encryptCTR(output, input, len);
-    omac.update(state.hash, output, len);
+    while (len > 0) {
+        size_t size;
+        if (state.encPosn == 16 && len >= 16) {
+            // Encrypt and authenticate whole blocks in a single pass.
+            size = len & ~((size_t)15);
+            processBlocks(output, input, size, true);
+        } else {
+            // Handle a partial block at the start or end of the request.
+            size = state.encPosn == 16 ? len : 16 - state.encPosn;
+            if (size > len)
+                size = len;
+            encryptCTR(output, input, size);
+            omac.update(state.hash, output, size);
+        }
+        input += size;
+        output += size;
+        len -= size;
+    }
 }
 
 void EAXCommon::decrypt(uint8_t *output, const uint8_t *input, size_t len)
 {
     if (state.authMode)
         closeAuthData();
-    omac.update(state.hash, input, len);
-    encryptCTR(output, input, len);
+    while (len > 0) {
+        size_t size;
+        if (state.encPosn == 16 && len >= 16) {
+            // Authenticate and decrypt whole blocks in a single pass.
+            size = len & ~((size_t)15);
+            processBlocks(output, input, size, false);
+        } else {
+            // Handle a partial block at the start or end of the request.
+            size = state.encPosn == 16 ? len : 16 - state.encPosn;
+            if (size > len)
+                size = len;
+            omac.update(state.hash, input, size);
+            encryptCTR(output, input, size);
+        }
+        input += size;
+        output += size;
+        len -= size;
+    }
 }
 
 void EAXCommon::addAuthData(const void *data, size_t len)
@@ -141,6 +179,7 @@ bool EAXCommon::checkTag(const void *tag, size_t len)
 void EAXCommon::clear()
 {
     clean(state);
+    omac.clear();
 }
 
 /**
@@ -159,6 +198,22 @@ void EAXCommon::closeAuthData()
     omac.initNext(state.hash, 2);
 }
 
+// Increment the counter, taking care not to reveal any timing
+// information about the starting value.  We iterate through the
+// entire counter region even if we could stop earlier because a
+// byte is non-zero.
+static inline void increment(uint8_t counter[16])
+{
+    uint16_t temp = 1;
+    uint8_t index = 16;
+    while (index > 0) {
+        --index;
+        temp += counter[index];
+        counter[index] = (uint8_t)temp;
+        temp >>= 8;
+    }
+}
+
 /**
  * \brief Encrypts or decrypts a region using the block cipher in CTR mode.
  *
@@ -176,19 +231,7 @@ void EAXCommon::encryptCTR(uint8_t *output, const uint8_t *input, size_t len)
             // Encrypt the counter to create the next keystream block.
             omac.blockCipher()->encryptBlock(state.stream, state.counter);
             state.encPosn = 0;
-
-            // Increment the counter, taking care not to reveal
-            // any timing information about the starting value.
-            // We iterate through the entire counter region even
-            // if we could stop earlier because a byte is non-zero.
-            uint16_t temp = 1;
-            uint8_t index = 16;
-            while (index > 0) {
-                --index;
-                temp += state.counter[index];
-                state.counter[index] = (uint8_t)temp;
-                temp >>= 8;
-            }
+            increment(state.counter);
         }
 
         // Encrypt/decrypt the current input block.
@@ -205,6 +248,52 @@ void EAXCommon::encryptCTR(uint8_t *output, const uint8_t *input, size_t len)
     }
 }
 
+/**
+ * \brief Encrypts or decrypts whole blocks and authenticates the
+ * ciphertext in a single pass.
+ *
+ * \param output The output buffer to write to, which may be the same
+ * buffer as \a input.
+ * \param input The input buffer to read from.
+ * \param len The number of bytes to process, which must be a multiple of 16.
+ * \param encrypting Set to true to encrypt or false to decrypt.
+ *
+ * This must only be called on a block boundary.  The OMAC context over
+ * the ciphertext is then also on a block boundary with its last block
+ * full but not yet encrypted.  That pending OMAC block and the next
+ * counter block are independent, so they are encrypted together with
+ * a single two-block call to the block cipher.
+ */
+void EAXCommon::processBlocks(uint8_t *output, const uint8_t *input,
+                              size_t len, bool encrypting)
+{
+    BlockCipher *cipher = omac.blockCipher();
+    uint8_t blocks[32];
+    while (len > 0) {
+        memcpy(blocks, state.hash, 16);
+        memcpy(blocks + 16, state.counter, 16);
+        increment(state.counter);
+        cipher->encryptBlocks(blocks, blocks, 2);
+        if (encrypting) {
+            for (uint8_t index = 0; index < 16; ++index) {
+                uint8_t c = input[index] ^ blocks[index + 16];
+                output[index] = c;
+                state.hash[index] = blocks[index] ^ c;
+            }
+        } else {
+            for (uint8_t index = 0; index < 16; ++index) {
+                uint8_t c = input[index];
+                state.hash[index] = blocks[index] ^ c;
+                output[index] = c ^ blocks[index + 16];
+            }
+        }
+        input += 16;
+        output += 16;
+        len -= 16;
+    }
+    clean(blocks);
+}
+
 void EAXCommon::closeTag()
 {
     // If we were only authenticating, then close off auth mode.
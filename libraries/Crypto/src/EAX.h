@@ -69,6 +69,8 @@ private:
 
     void closeAuthData();
     void encryptCTR(uint8_t *output, const uint8_t *input, size_t len);
+    void processBlocks(uint8_t *output, const uint8_t *input, size_t len,
+                       bool encrypting);
     void closeTag();
 };
 
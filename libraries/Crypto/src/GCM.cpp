@@ -43,6 +43,9 @@
  */
 GCMCommon::GCMCommon()
     : blockCipher(0)
+#if defined(CRYPTO_GCM_HW)
+    , aesCipher(0)
+#endif
 {
     state.authSize = 0;
     state.dataSize = 0;
@@ -121,6 +124,9 @@ bool GCMCommon::setIV(const uint8_t *iv, size_t len)
     return true;
 }
 
+// Number of counter blocks to encrypt at once with encryptBlocks().
+#define GCM_BATCH_BLOCKS 4
+
 /**
  * \brief Increments the least significant 32 bits of the counter block.
  *
@@ -147,29 +153,21 @@ void GCMCommon::encrypt(uint8_t *output, const uint8_t *input, size_t len)
         state.dataStarted = true;
     }
 
-    // Encrypt the plaintext using the block cipher in counter mode.
-    uint8_t *out = output;
-    size_t size = len;
-    while (size > 0) {
-        // Create a new keystream block if necessary.
-        if (state.posn >= 16) {
-            increment(state.counter);
-            blockCipher->encryptBlock(state.stream, state.counter);
-            state.posn = 0;
-        }
-
-        // Encrypt as many bytes as we can using the keystream block.
-        uint8_t temp = 16 - state.posn;
-        if (temp > size)
-            temp = size;
-        uint8_t *stream = state.stream + state.posn;
-        state.posn += temp;
-        size -= temp;
-        while (temp > 0) {
-            *out++ = *input++ ^ *stream++;
-            --temp;
-        }
+#if defined(CRYPTO_GCM_HW)
+    // Encrypt and hash groups of eight whole blocks in a single pass.
+    if (aesCipher && state.posn >= 16 && len >= 128 &&
+            AESCommon::hwAvailable() && GHASH::hwAvailable()) {
+        size_t size = len & ~((size_t)127);
+        hwEncrypt(output, input, size / 16);
+        state.dataSize += size;
+        output += size;
+        input += size;
+        len -= size;
     }
+#endif
+
+    // Encrypt the plaintext using the block cipher in counter mode.
+    encryptCTR(output, input, len);
 
     // Feed the ciphertext into the hash.
     ghash.update(output, len);
@@ -184,31 +182,25 @@ void GCMCommon::decrypt(uint8_t *output, const uint8_t *input, size_t len)
         state.dataStarted = true;
     }
 
+#if defined(CRYPTO_GCM_HW)
+    // Hash and decrypt groups of eight whole blocks in a single pass.
+    if (aesCipher && state.posn >= 16 && len >= 128 &&
+            AESCommon::hwAvailable() && GHASH::hwAvailable()) {
+        size_t size = len & ~((size_t)127);
+        hwDecrypt(output, input, size / 16);
+        state.dataSize += size;
+        output += size;
+        input += size;
+        len -= size;
+    }
+#endif
+
     // Feed the ciphertext into the hash before we decrypt it.
     ghash.update(input, len);
     state.dataSize += len;
 
     // Decrypt the plaintext using the block cipher in counter mode.
-    while (len > 0) {
-        // Create a new keystream block if necessary.
-        if (state.posn >= 16) {
-            increment(state.counter);
-            blockCipher->encryptBlock(state.stream, state.counter);
-            state.posn = 0;
-        }
-
-        // Decrypt as many bytes as we can using the keystream block.
-        uint8_t temp = 16 - state.posn;
-        if (temp > len)
-            temp = len;
-        uint8_t *stream = state.stream + state.posn;
-        state.posn += temp;
-        len -= temp;
-        while (temp > 0) {
-            *output++ = *input++ ^ *stream++;
-            --temp;
-        }
-    }
+    encryptCTR(output, input, len);
 }
 
 void GCMCommon::addAuthData(const void *data, size_t len)
@@ -250,6 +242,54 @@ bool GCMCommon::checkTag(const void *tag, size_t len)
     return secure_compare(state.counter, tag, len);
 }
 
+void GCMCommon::encryptCTR(uint8_t *output, const uint8_t *input, size_t len)
+{
+    uint8_t blocks[GCM_BATCH_BLOCKS * 16];
+    bool batched = false;
+    while (len > 0) {
+        if (state.posn >= 16 && len >= 16) {
+            // Generate the keystream for several whole blocks at once
+            // so that the block cipher can process them in parallel.
+            size_t count = len / 16;
+            if (count > GCM_BATCH_BLOCKS)
+                count = GCM_BATCH_BLOCKS;
+            for (size_t index = 0; index < count; ++index) {
+                increment(state.counter);
+                memcpy(blocks + index * 16, state.counter, 16);
+            }
+            blockCipher->encryptBlocks(blocks, blocks, count);
+            for (size_t index = 0; index < count * 16; ++index)
+                output[index] = input[index] ^ blocks[index];
+            input += count * 16;
+            output += count * 16;
+            len -= count * 16;
+            batched = true;
+            continue;
+        }
+
+        // Create a new keystream block if necessary.
+        if (state.posn >= 16) {
+            increment(state.counter);
+            blockCipher->encryptBlock(state.stream, state.counter);
+            state.posn = 0;
+        }
+
+        // Encrypt as many bytes as we can using the keystream block.
+        uint8_t temp = 16 - state.posn;
+        if (temp > len)
+            temp = len;
+        uint8_t *stream = state.stream + state.posn;
+        state.posn += temp;
+        len -= temp;
+        while (temp > 0) {
+            *output++ = *input++ ^ *stream++;
+            --temp;
+        }
+    }
+    if (batched)
+        clean(blocks);
+}
+
 void GCMCommon::clear()
 {
     blockCipher->clear();
@@ -323,6 +363,12 @@ void GCMCommon::clear()
  * gcm.computeTag(tag, sizeof(tag));
  * \endcode
  *
+ * When T is AES128, AES192, or AES256 on an x86-64 host that has AES-NI
+ * and PCLMULQDQ, encrypt() and decrypt() process groups of eight whole
+ * blocks in a single pass that interleaves the AES rounds with the GHASH
+ * multiplications.  For best performance, pass large buffers to encrypt()
+ * and decrypt() in multiples of 128 bytes.
+ *
  * References: <a href="http://csrc.nist.gov/publications/nistpubs/800-38D/SP-800-38D.pdf">NIST SP 800-38D</a>,
  * http://en.wikipedia.org/wiki/Galois/Counter_Mode
  *
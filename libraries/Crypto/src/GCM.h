@@ -26,6 +26,12 @@
 #include "AuthenticatedCipher.h"
 #include "BlockCipher.h"
 #include "GHASH.h"
+#include "AES.h"
+
+// Determine if AES-GCM can use the stitched AES-NI and PCLMULQDQ code.
+#if defined(CRYPTO_AES_HW) && defined(CRYPTO_GHASH_HW) && defined(__x86_64__)
+#define CRYPTO_GCM_HW 1
+#endif
 
 class GCMCommon : public AuthenticatedCipher
 {
@@ -52,9 +58,19 @@ public:
 protected:
     GCMCommon();
     void setBlockCipher(BlockCipher *cipher) { blockCipher = cipher; }
+#if defined(CRYPTO_GCM_HW)
+    void setBlockCipher(AESCommon *cipher)
+    {
+        blockCipher = cipher;
+        aesCipher = cipher;
+    }
+#endif
 
 private:
     BlockCipher *blockCipher;
+#if defined(CRYPTO_GCM_HW)
+    AESCommon *aesCipher;
+#endif
     GHASH ghash;
     struct {
         uint8_t counter[16];
@@ -65,6 +81,13 @@ private:
         bool dataStarted;
         uint8_t posn;
     } state;
+
+    void encryptCTR(uint8_t *output, const uint8_t *input, size_t len);
+
+#if defined(CRYPTO_GCM_HW)
+    void hwEncrypt(uint8_t *output, const uint8_t *input, size_t blocks);
+    void hwDecrypt(uint8_t *output, const uint8_t *input, size_t blocks);
+#endif
 };
 
 template <typename T>
@@ -22,6 +22,7 @@
 
 #include "GF128.h"
 #include "utility/EndianUtil.h"
+#include "utility/ProgMemUtil.h"
 #include <string.h>
 
 /**
@@ -298,6 +299,121 @@ void GF128::mul(uint32_t Y[4], const uint32_t H[4])
 #endif // !__AVR__
 }
 
+/**
+ * \brief Initialize table-driven multiplication in the GF(2^128) field.
+ *
+ * \param M The 256-byte table of multiples of the key to be initialized.
+ * \param key Points to the 16 byte authentication key which is assumed
+ * to be in big-endian byte order.
+ *
+ * The table holds the products of the key with every 4-bit value, as
+ * described by Shoup.  It is used by mulTable() to multiply by the key
+ * 4 bits at a time instead of 1 bit at a time as in mul().
+ *
+ * \note The table lookups in mulTable() are indexed by the data being
+ * hashed.  This is only safe on devices without a data cache, such as
+ * AVR and Cortex-M0/M3/M4 microcontrollers running from on-chip SRAM,
+ * where the timing of a lookup does not depend upon its address.
+ *
+ * \sa mulTable(), mulInit()
+ */
+void GF128::mulInitTable(uint32_t M[16][4], const void *key)
+{
+    // M[8] is the key itself.  M[4], M[2], and M[1] are the key multiplied
+    // by x, x^2, and x^3, which is a right shift in the GCM bit ordering.
+    memcpy(M[8], key, 16);
+    M[8][0] = be32toh(M[8][0]);
+    M[8][1] = be32toh(M[8][1]);
+    M[8][2] = be32toh(M[8][2]);
+    M[8][3] = be32toh(M[8][3]);
+    for (uint8_t i = 4; i > 0; i >>= 1) {
+        const uint32_t *V = M[i * 2];
+        uint32_t mask = ((~(V[3] & 0x01)) + 1) & 0xE1000000;
+        M[i][3] = (V[3] >> 1) | (V[2] << 31);
+        M[i][2] = (V[2] >> 1) | (V[1] << 31);
+        M[i][1] = (V[1] >> 1) | (V[0] << 31);
+        M[i][0] = (V[0] >> 1) ^ mask;
+    }
+
+    // The other entries are sums of the powers of two.
+    memset(M[0], 0, 16);
+    for (uint8_t i = 2; i < 16; i <<= 1) {
+        for (uint8_t j = 1; j < i; ++j) {
+            M[i + j][0] = M[i][0] ^ M[j][0];
+            M[i + j][1] = M[i][1] ^ M[j][1];
+            M[i + j][2] = M[i][2] ^ M[j][2];
+            M[i + j][3] = M[i][3] ^ M[j][3];
+        }
+    }
+}
+
+/** @cond gf128_table */
+
+// Reduction values for the 4 bits that are shifted out of the bottom
+// of Z when it is multiplied by x^4, shifted down by 16 bits.
+static uint16_t const reduce4[16] PROGMEM = {
+    0x0000, 0x1C20, 0x3840, 0x2460, 0x7080, 0x6CA0, 0x48C0, 0x54E0,
+    0xE100, 0xFD20, 0xD940, 0xC560, 0x9180, 0x8DA0, 0xA9C0, 0xB5E0
+};
+
+/** @endcond */
+
+/**
+ * \brief Perform a table-driven multiplication in the GF(2^128) field.
+ *
+ * \param Y The first value to multiply, and the result.  This array is
+ * assumed to be in big-endian order on entry and exit.
+ * \param M The table of multiples of the second value, which must have
+ * been initialized by the mulInitTable() function.
+ *
+ * This produces the same result as mul() but is several times faster.
+ * See the note for mulInitTable() for when it is safe to use.
+ *
+ * \sa mulInitTable(), mul()
+ */
+void GF128::mulTable(uint32_t Y[4], const uint32_t M[16][4])
+{
+    // Horner's rule over the 32 nibbles of Y, starting with the last.
+    // Within each byte, the high nibble comes first in GCM bit order.
+    const uint8_t *y = (const uint8_t *)Y;
+    uint32_t Z0 = 0;
+    uint32_t Z1 = 0;
+    uint32_t Z2 = 0;
+    uint32_t Z3 = 0;
+    uint8_t posn = 16;
+    uint8_t nibble = 0;
+    while (posn > 0) {
+        --posn;
+        for (uint8_t half = 0; half < 2; ++half) {
+            if (half)
+                nibble = y[posn] >> 4;
+            else
+                nibble = y[posn] & 0x0F;
+
+            // Multiply Z by x^4 and reduce.
+            uint32_t r = ((uint32_t)pgm_read_word(&(reduce4[Z3 & 0x0F]))) << 16;
+            Z3 = (Z3 >> 4) | (Z2 << 28);
+            Z2 = (Z2 >> 4) | (Z1 << 28);
+            Z1 = (Z1 >> 4) | (Z0 << 28);
+            Z0 = (Z0 >> 4) ^ r;
+
+            // Add the multiple of H for this nibble.
+            const uint32_t *m = M[nibble];
+            Z0 ^= m[0];
+            Z1 ^= m[1];
+            Z2 ^= m[2];
+            Z3 ^= m[3];
+        }
+    }
+    nibble = 0;
+
+    // Copy Z into Y and byte-swap.
+    Y[0] = htobe32(Z0);
+    Y[1] = htobe32(Z1);
+    Y[2] = htobe32(Z2);
+    Y[3] = htobe32(Z3);
+}
+
 /**
  * \brief Doubles a value in the GF(2^128) field.
  *
@@ -35,6 +35,17 @@
  * hashing primitive that is used by both GCM and GMAC.  GMAC can be
  * simulated using GCM and an empty plaintext/ciphertext.
  *
+ * On x86-64 and ARMv8 hosts the carry-less multiply instructions of the
+ * CPU (PCLMULQDQ or PMULL) are used if the CPU supports them, which is
+ * detected at runtime.  The powers H, H^2, ..., H^8 of the hash key are
+ * precomputed by reset() so that update() can hash eight blocks with a
+ * single reduction.  Define CRYPTO_NO_GHASH_HW when compiling the library
+ * to always use the portable implementation.
+ *
+ * On microcontrollers without a data cache, CRYPTO_GHASH_TABLE can be
+ * defined to use a faster table-driven multiplication.  See the note in
+ * GHASH.h for when this is safe.
+ *
  * References: <a href="http://csrc.nist.gov/publications/nistpubs/800-38D/SP-800-38D.pdf">NIST SP 800-38D</a>,
  * http://en.wikipedia.org/wiki/Galois/Counter_Mode
  *
@@ -67,6 +78,13 @@ GHASH::~GHASH()
 void GHASH::reset(const void *key)
 {
     GF128::mulInit(state.H, key);
+#if defined(CRYPTO_GHASH_HW)
+    if (hwAvailable())
+        hwInit(state.Hpow, key);
+#endif
+#if defined(CRYPTO_GHASH_TABLE)
+    GF128::mulInitTable(state.M, key);
+#endif
     memset(state.Y, 0, sizeof(state.Y));
     state.posn = 0;
 }
@@ -87,6 +105,16 @@ void GHASH::update(const void *data, size_t len)
     // XOR the input with state.Y in 128-bit chunks and process them.
     const uint8_t *d = (const uint8_t *)data;
     while (len > 0) {
+#if defined(CRYPTO_GHASH_HW)
+        if (state.posn == 0 && len >= 16 && hwAvailable()) {
+            // Hash all whole blocks at once with carry-less multiplication.
+            size_t blocks = len / 16;
+            hwUpdate(state.Y, state.Hpow, d, blocks);
+            len -= blocks * 16;
+            d += blocks * 16;
+            continue;
+        }
+#endif
         uint8_t size = 16 - state.posn;
         if (size > len)
             size = len;
@@ -97,7 +125,7 @@ void GHASH::update(const void *data, size_t len)
         len -= size;
         d += size;
         if (state.posn == 16) {
-            GF128::mul(state.Y, state.H);
+            mulH();
             state.posn = 0;
         }
     }
@@ -139,7 +167,7 @@ void GHASH::pad()
     if (state.posn != 0) {
         // Padding involves XOR'ing the rest of state.Y with zeroes,
         // which does nothing.  Immediately process the next chunk.
-        GF128::mul(state.Y, state.H);
+        mulH();
         state.posn = 0;
     }
 }
@@ -151,3 +179,19 @@ void GHASH::clear()
 {
     clean(state);
 }
+
+// Multiplies Y by the hash key H.
+void GHASH::mulH()
+{
+#if defined(CRYPTO_GHASH_HW)
+    if (hwAvailable()) {
+        hwMul(state.Y, state.Hpow);
+        return;
+    }
+#endif
+#if defined(CRYPTO_GHASH_TABLE)
+    GF128::mulTable(state.Y, state.M);
+#else
+    GF128::mul(state.Y, state.H);
+#endif
+}
@@ -26,6 +26,26 @@
 #include <inttypes.h>
 #include <stddef.h>
 
+// Determine if the host CPU may have carry-less multiply instructions
+// that can be selected at runtime.  Define CRYPTO_NO_GHASH_HW to always
+// use the portable bit-serial implementation instead.
+#if !defined(CRYPTO_NO_GHASH_HW) && defined(__GNUC__)
+#if defined(__x86_64__)
+#define CRYPTO_GHASH_HW 1
+#elif defined(__aarch64__) && defined(__linux__) && \
+      (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define CRYPTO_GHASH_HW 1
+#endif
+#endif
+
+// Define CRYPTO_GHASH_TABLE here or in the compiler flags to multiply by
+// the hash key 4 bits at a time with a 256-byte table of multiples of the
+// key in each GHASH object, instead of 1 bit at a time.  This is several
+// times faster, but the table lookups are indexed by the data being hashed.
+// Only use this on devices without a data cache where the time of a memory
+// access does not depend upon its address, such as AVR or the Cortex-M4 in
+// the nRF52.  Never use it on a host system or on a part with a data cache.
+
 class GHASH
 {
 public:
@@ -44,8 +64,26 @@ private:
     struct {
         uint32_t H[4];
         uint32_t Y[4];
+#if defined(CRYPTO_GHASH_HW)
+        uint32_t Hpow[8][4];
+#endif
+#if defined(CRYPTO_GHASH_TABLE)
+        uint32_t M[16][4];
+#endif
         uint8_t posn;
     } state;
+
+    void mulH();
+
+#if defined(CRYPTO_GHASH_HW)
+    static bool hwAvailable();
+    static void hwInit(uint32_t Hpow[8][4], const void *key);
+    static void hwMul(uint32_t Y[4], const uint32_t Hpow[8][4]);
+    static void hwUpdate(uint32_t Y[4], const uint32_t Hpow[8][4],
+                         const uint8_t *data, size_t blocks);
+#endif
+
+    friend class GCMCommon;
 };
 
 #endif
@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "GHASH.h"
+#include "GCM.h"
+#include "Crypto.h"
+#include <string.h>
+
+// GHASH implementation using the carry-less multiply instructions of the
+// host CPU: PCLMULQDQ on x86-64 and PMULL on ARMv8.  The functions here
+// are only called by GHASH after hwAvailable() returns true.
+//
+// Field elements are byte-reversed on load so that bit i of the GHASH
+// bit string ends up in bit 127 - i of the 128-bit register.  Products
+// of up to eight blocks with H^8, ..., H are accumulated without
+// reduction and then reduced once modulo x^128 + x^7 + x^2 + x + 1.
+//
+// On x86-64 this file also provides the stitched AES-CTR and GHASH code
+// for GCM, which shares the carry-less multiply helpers.
+//
+// Reference: https://www.intel.com/content/dam/develop/external/us/en/documents/clmul-wp-rev-2-02-2014-04-20.pdf
+
+#if defined(CRYPTO_GHASH_HW)
+
+#if defined(__x86_64__)
+
+#include <cpuid.h>
+#include <wmmintrin.h>
+#include <tmmintrin.h>
+
+#define CRYPTO_GHASH_HW_TARGET __attribute__((target("pclmul,ssse3")))
+
+typedef __m128i block_t;
+
+#define XOR(a, b)           _mm_xor_si128((a), (b))
+#define SHL64(a, n)         _mm_slli_epi64((a), (n))
+#define SHR64(a, n)         _mm_srli_epi64((a), (n))
+#define LOW_TO_HIGH(a)      _mm_slli_si128((a), 8)
+#define HIGH_TO_LOW(a)      _mm_srli_si128((a), 8)
+#define ZERO()              _mm_setzero_si128()
+
+CRYPTO_GHASH_HW_TARGET static inline block_t bswap(block_t x)
+{
+    const __m128i mask =
+        _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    return _mm_shuffle_epi8(x, mask);
+}
+
+CRYPTO_GHASH_HW_TARGET static inline block_t load(const void *data)
+{
+    return bswap(_mm_loadu_si128((const __m128i *)data));
+}
+
+CRYPTO_GHASH_HW_TARGET static inline void store(void *data, block_t x)
+{
+    _mm_storeu_si128((__m128i *)data, bswap(x));
+}
+
+// Accumulates the unreduced 256-bit product of a and b into hi:mid:lo.
+CRYPTO_GHASH_HW_TARGET static inline void mulAcc
+    (block_t &lo, block_t &mid, block_t &hi, block_t a, block_t b)
+{
+    lo = XOR(lo, _mm_clmulepi64_si128(a, b, 0x00));
+    mid = XOR(mid, _mm_clmulepi64_si128(a, b, 0x01));
+    mid = XOR(mid, _mm_clmulepi64_si128(a, b, 0x10));
+    hi = XOR(hi, _mm_clmulepi64_si128(a, b, 0x11));
+}
+
+#else // ARMv8
+
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#include <arm_neon.h>
+
+#define CRYPTO_GHASH_HW_TARGET
+
+typedef uint64x2_t block_t;
+
+#define XOR(a, b)           veorq_u64((a), (b))
+#define SHL64(a, n)         vshlq_n_u64((a), (n))
+#define SHR64(a, n)         vshrq_n_u64((a), (n))
+#define LOW_TO_HIGH(a)      vextq_u64(vdupq_n_u64(0), (a), 1)
+#define HIGH_TO_LOW(a)      vextq_u64((a), vdupq_n_u64(0), 1)
+#define ZERO()              vdupq_n_u64(0)
+
+static inline block_t load(const void *data)
+{
+    uint8x16_t x = vrev64q_u8(vld1q_u8((const uint8_t *)data));
+    return vreinterpretq_u64_u8(vextq_u8(x, x, 8));
+}
+
+static inline void store(void *data, block_t x)
+{
+    uint8x16_t y = vrev64q_u8(vreinterpretq_u8_u64(x));
+    vst1q_u8((uint8_t *)data, vextq_u8(y, y, 8));
+}
+
+static inline block_t clmul(uint64_t a, uint64_t b)
+{
+    return vreinterpretq_u64_p128(vmull_p64((poly64_t)a, (poly64_t)b));
+}
+
+// Accumulates the unreduced 256-bit product of a and b into hi:mid:lo.
+static inline void mulAcc
+    (block_t &lo, block_t &mid, block_t &hi, block_t a, block_t b)
+{
+    uint64_t a0 = vgetq_lane_u64(a, 0);
+    uint64_t a1 = vgetq_lane_u64(a, 1);
+    uint64_t b0 = vgetq_lane_u64(b, 0);
+    uint64_t b1 = vgetq_lane_u64(b, 1);
+    lo = XOR(lo, clmul(a0, b0));
+    mid = XOR(mid, clmul(a1, b0));
+    mid = XOR(mid, clmul(a0, b1));
+    hi = XOR(hi, clmul(a1, b1));
+}
+
+#endif
+
+/** @cond ghash_hw */
+
+// Reduces the 256-bit product hi:mid:lo modulo the GHASH polynomial.
+CRYPTO_GHASH_HW_TARGET static inline block_t reduce
+    (block_t lo, block_t mid, block_t hi)
+{
+    block_t c, t;
+
+    // Fold the middle terms into the low and high halves.
+    lo = XOR(lo, LOW_TO_HIGH(mid));
+    hi = XOR(hi, HIGH_TO_LOW(mid));
+
+    // The product of two bit-reflected values is one bit short of
+    // the reflected product, so shift the 256-bit result left by 1.
+    c = SHR64(lo, 63);
+    lo = XOR(SHL64(lo, 1), LOW_TO_HIGH(c));
+    hi = XOR(XOR(SHL64(hi, 1), HIGH_TO_LOW(c)), LOW_TO_HIGH(SHR64(hi, 63)));
+
+    // The low half holds the terms x^128 to x^255.  Multiply them by
+    // x^7 + x^2 + x + 1 and add them to the high half.  Right shifts
+    // multiply by powers of x; the bits that fall off the bottom of
+    // the first shift are folded back in before the second one.
+    t = XOR(XOR(SHL64(lo, 63), SHL64(lo, 62)), SHL64(lo, 57));
+    lo = XOR(lo, LOW_TO_HIGH(t));
+    t = XOR(XOR(SHL64(lo, 63), SHL64(lo, 62)), SHL64(lo, 57));
+    hi = XOR(hi, lo);
+    hi = XOR(hi, XOR(XOR(SHR64(lo, 1), SHR64(lo, 2)), SHR64(lo, 7)));
+    return XOR(hi, HIGH_TO_LOW(t));
+}
+
+CRYPTO_GHASH_HW_TARGET static inline block_t mul(block_t a, block_t b)
+{
+    block_t lo = ZERO();
+    block_t mid = ZERO();
+    block_t hi = ZERO();
+    mulAcc(lo, mid, hi, a, b);
+    return reduce(lo, mid, hi);
+}
+
+bool GHASH::hwAvailable()
+{
+    // -1 until the CPU has been probed, then 0 or 1.
+    static int available = -1;
+    if (available < 0) {
+#if defined(__x86_64__)
+        unsigned eax, ebx, ecx, edx;
+        available = (__get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+                     (ecx & bit_PCLMUL) != 0 && (ecx & bit_SSSE3) != 0);
+#else
+        available = (getauxval(AT_HWCAP) & HWCAP_PMULL) != 0;
+#endif
+    }
+    return available != 0;
+}
+
+CRYPTO_GHASH_HW_TARGET void GHASH::hwInit(uint32_t Hpow[8][4], const void *key)
+{
+    // Hpow[i] is H^(i + 1) in the byte-reversed register format.
+    block_t h = load(key);
+    block_t p = h;
+    memcpy(Hpow[0], &p, 16);
+    for (uint8_t i = 1; i < 8; ++i) {
+        p = mul(p, h);
+        memcpy(Hpow[i], &p, 16);
+    }
+}
+
+CRYPTO_GHASH_HW_TARGET void GHASH::hwMul(uint32_t Y[4], const uint32_t Hpow[8][4])
+{
+    block_t h;
+    memcpy(&h, Hpow[0], 16);
+    store(Y, mul(load(Y), h));
+}
+
+CRYPTO_GHASH_HW_TARGET void GHASH::hwUpdate
+    (uint32_t Y[4], const uint32_t Hpow[8][4], const uint8_t *data, size_t blocks)
+{
+    // Process up to eight blocks at a time with one reduction:
+    // Y = (Y + X1) * H^n + X2 * H^(n-1) + ... + Xn * H.
+    block_t y = load(Y);
+    block_t h;
+    while (blocks > 0) {
+        uint8_t n = (blocks < 8) ? (uint8_t)blocks : 8;
+        block_t lo = ZERO();
+        block_t mid = ZERO();
+        block_t hi = ZERO();
+        memcpy(&h, Hpow[n - 1], 16);
+        mulAcc(lo, mid, hi, XOR(y, load(data)), h);
+        for (uint8_t i = 1; i < n; ++i) {
+            memcpy(&h, Hpow[n - 1 - i], 16);
+            mulAcc(lo, mid, hi, load(data + i * 16), h);
+        }
+        y = reduce(lo, mid, hi);
+        data += n * 16;
+        blocks -= n;
+    }
+    store(Y, y);
+}
+
+#if defined(CRYPTO_GCM_HW)
+
+#define CRYPTO_GCM_HW_TARGET __attribute__((target("aes,pclmul,ssse3")))
+
+// The counter block is kept byte-reversed so that the 32-bit big-endian
+// counter in the last four bytes of the block is in the lowest lane and
+// can be incremented with _mm_add_epi32().  This wraps around modulo 2^32
+// in the same way as the inc32() function of GCM.
+
+CRYPTO_GCM_HW_TARGET void GCMCommon::hwEncrypt
+    (uint8_t *output, const uint8_t *input, size_t blocks)
+{
+    // Encrypt eight counter blocks per pass.  The eight ciphertext blocks
+    // from the previous pass are multiplied into the hash one per AES
+    // round while the AES instructions are in flight.
+    const __m128i *rk = (const __m128i *)(aesCipher->schedule);
+    uint8_t rounds = aesCipher->rounds;
+    const __m128i one = _mm_set_epi32(0, 0, 0, 1);
+    __m128i ctr = load(state.counter);
+    block_t y = load(ghash.state.Y);
+    block_t prev[8];
+    block_t s[8];
+    block_t lo, mid, hi, h, k, c;
+    bool pending = false;
+    uint8_t i, round;
+    for (; blocks >= 8; blocks -= 8, input += 128, output += 128) {
+        k = _mm_loadu_si128(rk);
+        for (i = 0; i < 8; ++i) {
+            ctr = _mm_add_epi32(ctr, one);
+            s[i] = XOR(bswap(ctr), k);
+        }
+        lo = mid = hi = ZERO();
+        for (round = 1; round < rounds; ++round) {
+            k = _mm_loadu_si128(rk + round);
+            for (i = 0; i < 8; ++i)
+                s[i] = _mm_aesenc_si128(s[i], k);
+            if (pending && round <= 8) {
+                memcpy(&h, ghash.state.Hpow[8 - round], 16);
+                mulAcc(lo, mid, hi, prev[round - 1], h);
+            }
+        }
+        if (pending)
+            y = reduce(lo, mid, hi);
+        k = _mm_loadu_si128(rk + rounds);
+        for (i = 0; i < 8; ++i) {
+            c = XOR(_mm_aesenclast_si128(s[i], k),
+                    _mm_loadu_si128((const __m128i *)(input + i * 16)));
+            _mm_storeu_si128((__m128i *)(output + i * 16), c);
+            prev[i] = bswap(c);
+        }
+        prev[0] = XOR(prev[0], y);
+        pending = true;
+    }
+
+    // Hash the last group of ciphertext blocks.
+    if (pending) {
+        lo = mid = hi = ZERO();
+        for (i = 0; i < 8; ++i) {
+            memcpy(&h, ghash.state.Hpow[7 - i], 16);
+            mulAcc(lo, mid, hi, prev[i], h);
+        }
+        y = reduce(lo, mid, hi);
+    }
+    store(ghash.state.Y, y);
+    store(state.counter, ctr);
+}
+
+CRYPTO_GCM_HW_TARGET void GCMCommon::hwDecrypt
+    (uint8_t *output, const uint8_t *input, size_t blocks)
+{
+    // The ciphertext is available up front, so each group of eight
+    // blocks is hashed while its own counter blocks are encrypted.
+    const __m128i *rk = (const __m128i *)(aesCipher->schedule);
+    uint8_t rounds = aesCipher->rounds;
+    const __m128i one = _mm_set_epi32(0, 0, 0, 1);
+    __m128i ctr = load(state.counter);
+    block_t y = load(ghash.state.Y);
+    block_t x[8];
+    block_t s[8];
+    block_t lo, mid, hi, h, k;
+    uint8_t i, round;
+    for (; blocks >= 8; blocks -= 8, input += 128, output += 128) {
+        k = _mm_loadu_si128(rk);
+        for (i = 0; i < 8; ++i) {
+            ctr = _mm_add_epi32(ctr, one);
+            s[i] = XOR(bswap(ctr), k);
+            x[i] = load(input + i * 16);
+        }
+        x[0] = XOR(x[0], y);
+        lo = mid = hi = ZERO();
+        for (round = 1; round < rounds; ++round) {
+            k = _mm_loadu_si128(rk + round);
+            for (i = 0; i < 8; ++i)
+                s[i] = _mm_aesenc_si128(s[i], k);
+            if (round <= 8) {
+                memcpy(&h, ghash.state.Hpow[8 - round], 16);
+                mulAcc(lo, mid, hi, x[round - 1], h);
+            }
+        }
+        y = reduce(lo, mid, hi);
+        k = _mm_loadu_si128(rk + rounds);
+        for (i = 0; i < 8; ++i) {
+            block_t p = XOR(_mm_aesenclast_si128(s[i], k),
+                            _mm_loadu_si128((const __m128i *)(input + i * 16)));
+            _mm_storeu_si128((__m128i *)(output + i * 16), p);
+        }
+    }
+    store(ghash.state.Y, y);
+    store(state.counter, ctr);
+}
+
+#endif // CRYPTO_GCM_HW
+
+/** @endcond */
+
+#endif // CRYPTO_GHASH_HW
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "HMACKey.h"
+#include "Crypto.h"
+#include <string.h>
+
+/**
+ * \class HMACKeyCommon HMACKey.h <HMACKey.h>
+ * \brief Concrete base class to assist with implementing HMAC with
+ * a cached key schedule.
+ *
+ * \sa HMACKey
+ */
+
+// Largest block and hash sizes of any Hash algorithm in the library
+// (SHA3_256 and SHA512/BLAKE2b respectively).
+#define HMAC_MAX_BLOCK_SIZE 136
+#define HMAC_MAX_HASH_SIZE  64
+
+/**
+ * \brief Constructs a new HMAC key context.
+ *
+ * This constructor must be followed by a call to setHashes().
+ */
+HMACKeyCommon::HMACKeyCommon()
+    : innerHash(0)
+    , outerHash(0)
+    , workHash(0)
+{
+}
+
+/**
+ * \brief Destroys this HMAC key context after clearing sensitive information.
+ *
+ * The Hash objects are owned by the subclass and will clear themselves.
+ */
+HMACKeyCommon::~HMACKeyCommon()
+{
+}
+
+/**
+ * \brief Returns the size of the HMAC result from finalize().
+ */
+size_t HMACKeyCommon::hashSize() const
+{
+    return workHash->hashSize();
+}
+
+/**
+ * \brief Sets the HMAC key and precomputes the inner and outer hash states.
+ *
+ * \param key Points to the HMAC key.
+ * \param len Length of the HMAC \a key in bytes.
+ *
+ * The ipad and opad blocks are absorbed once here.  After this,
+ * every message that is authenticated with reset(), update() and
+ * finalize() costs only the message blocks plus a single block for
+ * the outer hash.
+ *
+ * The HMAC process is also reset, ready for the first call to update().
+ *
+ * \sa reset(), clear()
+ */
+void HMACKeyCommon::setKey(const void *key, size_t len)
+{
+    uint8_t block[HMAC_MAX_BLOCK_SIZE];
+    size_t blockSize = workHash->blockSize();
+    size_t index;
+
+    // The inner state is the hash after absorbing key XOR ipad.
+    innerHash->resetHMAC(key, len);
+
+    // Hash long keys down to a single hash output first.
+    if (len > blockSize) {
+        workHash->reset();
+        workHash->update(key, len);
+        len = workHash->hashSize();
+        workHash->finalize(block, len);
+    } else {
+        memcpy(block, key, len);
+    }
+
+    // resetHMAC() will XOR the block with ipad (0x36), so pre-XOR the
+    // whole block with ipad ^ opad (0x6A) to end up with key XOR opad.
+    for (index = 0; index < len; ++index)
+        block[index] ^= 0x6A;
+    memset(block + len, 0x6A, blockSize - len);
+    outerHash->resetHMAC(block, blockSize);
+    clean(block);
+
+    copyInner();
+}
+
+/**
+ * \brief Resets the HMAC process ready to authenticate a new message
+ * under the current key.
+ *
+ * \sa update(), finalize(), setKey()
+ */
+void HMACKeyCommon::reset()
+{
+    copyInner();
+}
+
+/**
+ * \brief Updates the HMAC with more message data.
+ *
+ * \param data Data to be authenticated.
+ * \param len Number of bytes of data to be authenticated.
+ *
+ * \sa reset(), finalize()
+ */
+void HMACKeyCommon::update(const void *data, size_t len)
+{
+    workHash->update(data, len);
+}
+
+/**
+ * \brief Finalizes the HMAC process and returns the authentication code.
+ *
+ * \param mac The buffer to return the HMAC value in.
+ * \param len The length of the \a mac buffer, normally hashSize().
+ *
+ * Call reset() before authenticating another message with the same key.
+ *
+ * \sa reset(), update()
+ */
+void HMACKeyCommon::finalize(void *mac, size_t len)
+{
+    uint8_t temp[HMAC_MAX_HASH_SIZE];
+    size_t size = workHash->hashSize();
+    workHash->finalize(temp, size);
+    copyOuter();
+    workHash->update(temp, size);
+    workHash->finalize(mac, len);
+    clean(temp);
+}
+
+/**
+ * \brief Clears all sensitive information from this HMAC key context,
+ * including the cached inner and outer hash states.
+ */
+void HMACKeyCommon::clear()
+{
+    innerHash->clear();
+    outerHash->clear();
+    workHash->clear();
+}
+
+/**
+ * \fn void HMACKeyCommon::setHashes(Hash *inner, Hash *outer, Hash *hash)
+ * \brief Sets the Hash objects that hold the inner, outer and working
+ * hash states.
+ *
+ * \param inner Hash state after absorbing the key XOR ipad block.
+ * \param outer Hash state after absorbing the key XOR opad block.
+ * \param hash Hash state for the message that is currently being
+ * authenticated.
+ *
+ * This function must be called by the subclass constructor.
+ */
+
+/**
+ * \fn void HMACKeyCommon::copyInner()
+ * \brief Copies the inner hash state into the working hash.
+ */
+
+/**
+ * \fn void HMACKeyCommon::copyOuter()
+ * \brief Copies the outer hash state into the working hash.
+ */
+
+/**
+ * \class HMACKey HMACKey.h <HMACKey.h>
+ * \brief HMAC with precomputed inner and outer hash states for the
+ * hash algorithm T.
+ *
+ * Hash::resetHMAC() and Hash::finalizeHMAC() format the key and
+ * absorb the ipad and opad blocks for every message.  HMACKey does that
+ * work once in setKey() and then restores the cached states for each
+ * new message, which saves two compression function calls per HMAC
+ * when many messages are authenticated under the same key:
+ *
+ * \code
+ * HMACKey<SHA256> hmac;
+ * hmac.setKey(key, sizeof(key));
+ * for (...) {
+ *     hmac.reset();
+ *     hmac.update(data, sizeof(data));
+ *     hmac.finalize(mac, sizeof(mac));
+ * }
+ * \endcode
+ *
+ * The template parameter T can be any Hash subclass, including
+ * SHA256, SHA512, BLAKE2s, BLAKE2b, SHA3_256 and SHA3_512.
+ *
+ * The object holds three copies of the hash state, so it should not be
+ * used on memory-constrained platforms when only one or two messages will
+ * be authenticated under each key.
+ *
+ * \sa HMACKeyCommon, Hash::resetHMAC()
+ */
+
+/**
+ * \fn HMACKey::HMACKey()
+ * \brief Constructs a new HMAC key context for the hash algorithm T.
+ */
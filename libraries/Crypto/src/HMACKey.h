@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_HMACKEY_h
+#define CRYPTO_HMACKEY_h
+
+#include "Hash.h"
+
+class HMACKeyCommon
+{
+public:
+    virtual ~HMACKeyCommon();
+
+    size_t hashSize() const;
+
+    void setKey(const void *key, size_t len);
+
+    void reset();
+    void update(const void *data, size_t len);
+    void finalize(void *mac, size_t len);
+
+    void clear();
+
+protected:
+    HMACKeyCommon();
+    void setHashes(Hash *inner, Hash *outer, Hash *hash)
+    {
+        innerHash = inner;
+        outerHash = outer;
+        workHash = hash;
+    }
+
+    virtual void copyInner() = 0;
+    virtual void copyOuter() = 0;
+
+private:
+    Hash *innerHash;
+    Hash *outerHash;
+    Hash *workHash;
+};
+
+template <typename T>
+class HMACKey : public HMACKeyCommon
+{
+public:
+    HMACKey() { setHashes(&inner, &outer, &hash); }
+
+protected:
+    void copyInner() { hash = inner; }
+    void copyOuter() { hash = outer; }
+
+private:
+    T inner;
+    T outer;
+    T hash;
+};
+
+#endif
@@ -138,6 +138,15 @@ void KeccakCore::update(const void *data, size_t size)
     // Break the input up into chunks and process each in turn.
     const uint8_t *d = (const uint8_t *)data;
     while (size > 0) {
+        // Absorb whole blocks directly into the state a word at a time
+        // if we are on a block boundary.  The block size is always a
+        // multiple of 8 because the capacity is a multiple of 64.
+        if (state.inputSize == 0 && size >= _blockSize) {
+            absorbBlocks(d, size / _blockSize);
+            d += size - (size % _blockSize);
+            size %= _blockSize;
+            continue;
+        }
         uint8_t len = _blockSize - state.inputSize;
         if (len > size)
             len = size;
@@ -204,6 +213,14 @@ void KeccakCore::extract(void *data, size_t size)
         if (state.outputSize >= _blockSize) {
             keccakp();
             state.outputSize = 0;
+
+            // Squeeze whole blocks straight into the caller's buffer.
+            while (size > _blockSize) {
+                memcpy(d, state.A, _blockSize);
+                keccakp();
+                size -= _blockSize;
+                d += _blockSize;
+            }
         }
 
         // How many bytes can we copy this time around?
@@ -251,6 +268,15 @@ void KeccakCore::encrypt(void *output, const void *input, size_t size)
         if (state.outputSize >= _blockSize) {
             keccakp();
             state.outputSize = 0;
+
+            // XOR whole blocks of output a word at a time.
+            while (size > _blockSize) {
+                encryptBlock(out, in);
+                keccakp();
+                size -= _blockSize;
+                out += _blockSize;
+                in += _blockSize;
+            }
         }
 
         // How many bytes can we extract this time around?
@@ -318,6 +344,53 @@ void KeccakCore::setHMACKey(const void *key, size_t len, uint8_t pad, size_t has
     keccakp();
 }
 
+/**
+ * \brief Absorbs one or more full blocks of input into the sponge.
+ *
+ * \param data Points to the input data, which need not be aligned.
+ * \param blocks The number of blockSize() blocks to absorb.
+ *
+ * The caller must ensure that there is no partial block in progress.
+ */
+void KeccakCore::absorbBlocks(const uint8_t *data, size_t blocks)
+{
+    uint64_t *Awords = &(state.A[0][0]);
+    uint8_t words = _blockSize / 8;
+    uint64_t temp;
+    while (blocks > 0) {
+        for (uint8_t index = 0; index < words; ++index) {
+            memcpy(&temp, data, sizeof(temp));
+            Awords[index] ^= le64toh(temp);
+            data += sizeof(temp);
+        }
+        keccakp();
+        --blocks;
+    }
+}
+
+/**
+ * \brief XOR's a full block of squeezed output with the input.
+ *
+ * \param output Points to the output buffer, which need not be aligned.
+ * \param input Points to the input buffer, which need not be aligned.
+ *
+ * The block of output is taken from the current sponge state in its
+ * entirety; the caller is responsible for permuting afterwards.
+ */
+void KeccakCore::encryptBlock(uint8_t *output, const uint8_t *input)
+{
+    const uint64_t *Awords = &(state.A[0][0]);
+    uint8_t words = _blockSize / 8;
+    uint64_t temp;
+    for (uint8_t index = 0; index < words; ++index) {
+        memcpy(&temp, input, sizeof(temp));
+        temp ^= htole64(Awords[index]);
+        memcpy(output, &temp, sizeof(temp));
+        input += sizeof(temp);
+        output += sizeof(temp);
+    }
+}
+
 /**
  * \brief Transform the state with the KECCAK-p sponge function with b = 1600.
  */
@@ -57,6 +57,8 @@ private:
     } state;
     uint8_t _blockSize;
 
+    void absorbBlocks(const uint8_t *data, size_t blocks);
+    void encryptBlock(uint8_t *output, const uint8_t *input);
     void keccakp();
 };
 
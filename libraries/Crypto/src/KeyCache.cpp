@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "KeyCache.h"
+#include "Crypto.h"
+#include <string.h>
+
+/**
+ * \class KeyCacheCommon KeyCache.h <KeyCache.h>
+ * \brief Concrete base class to assist with implementing a cache of
+ * keyed cipher contexts.
+ *
+ * \sa KeyCache
+ */
+
+// States for each slot in the cache.  Empty must be zero so that
+// clean() on a slot also marks it as empty.
+#define SLOT_EMPTY  0
+#define SLOT_IDLE   1
+#define SLOT_IN_USE 2
+
+#if defined(CRYPTO_KEY_CACHE_LOCKING)
+#define lockCache() std::lock_guard<std::mutex> guard(mutex)
+#else
+#define lockCache() do { ; } while (0)
+#endif
+
+/**
+ * \brief Constructs a new key cache.
+ *
+ * This constructor must be followed by a call to setSlots().
+ */
+KeyCacheCommon::KeyCacheCommon()
+    : slots(0)
+    , count(0)
+    , useCounter(0)
+{
+}
+
+/**
+ * \brief Destroys this key cache.
+ *
+ * The slots and cipher contexts are owned by the subclass, which will
+ * wipe them with destroySlots() before they are destroyed.
+ */
+KeyCacheCommon::~KeyCacheCommon()
+{
+}
+
+/**
+ * \fn size_t KeyCacheCommon::capacity() const
+ * \brief Returns the maximum number of keys that can be held in the cache.
+ */
+
+/**
+ * \brief Evicts all keys from the cache and wipes the cipher contexts.
+ *
+ * Contexts that are currently acquired are not affected.
+ */
+void KeyCacheCommon::clear()
+{
+    lockCache();
+    for (size_t index = 0; index < count; ++index) {
+        if (slots[index].state == SLOT_IN_USE)
+            continue;
+        if (slots[index].state == SLOT_IDLE)
+            clearSlot(index);
+        clean(slots[index]);
+    }
+}
+
+// Quick FNV-1a hash of a key that is used to skip over slots that
+// cannot possibly match.  Matches are always confirmed by comparing
+// the full key so collisions are harmless.
+static uint32_t keyHash(const uint8_t *key, size_t len)
+{
+    uint32_t hash = 2166136261U;
+    while (len > 0) {
+        hash = (hash ^ *key++) * 16777619U;
+        --len;
+    }
+    return hash;
+}
+
+/**
+ * \brief Acquires a slot that has been set up with a specific key.
+ *
+ * \param index Returns the index of the slot.
+ * \param key Points to the raw key.
+ * \param len Length of the raw \a key in bytes.
+ *
+ * \return Returns false if \a len is too long, all slots are in use,
+ * or the key could not be set on the slot's cipher context.
+ *
+ * If an idle slot already holds \a key then it is returned as-is.
+ * Otherwise the least recently used idle slot is wiped with clearSlot()
+ * and then set up with setSlotKey().  The key is expanded outside the
+ * lock so that other threads are not held up while it happens.
+ */
+bool KeyCacheCommon::acquireSlot(size_t &index, const uint8_t *key, size_t len)
+{
+    if (len > KEY_CACHE_MAX_KEY_SIZE)
+        return false;
+    uint32_t hash = keyHash(key, len);
+    size_t victim = count;
+    uint8_t victimState = SLOT_EMPTY;
+    {
+        lockCache();
+        uint32_t oldest = 0;
+        ++useCounter;
+        for (size_t posn = 0; posn < count; ++posn) {
+            Slot &slot = slots[posn];
+            if (slot.state == SLOT_IN_USE)
+                continue;
+            if (slot.state == SLOT_IDLE && slot.hash == hash &&
+                    slot.keyLen == len && secure_compare(slot.key, key, len)) {
+                // Cache hit: the key schedule is already expanded.
+                slot.state = SLOT_IN_USE;
+                slot.lastUsed = useCounter;
+                index = posn;
+                return true;
+            }
+            uint32_t age;
+            if (slot.state == SLOT_EMPTY)
+                age = 0xFFFFFFFFU;
+            else
+                age = useCounter - slot.lastUsed;
+            if (victim == count || age > oldest) {
+                victim = posn;
+                oldest = age;
+            }
+        }
+        if (victim == count)
+            return false;
+
+        // Claim the victim slot for the new key.
+        Slot &slot = slots[victim];
+        victimState = slot.state;
+        clean(slot.key);
+        memcpy(slot.key, key, len);
+        slot.hash = hash;
+        slot.keyLen = (uint8_t)len;
+        slot.lastUsed = useCounter;
+        slot.state = SLOT_IN_USE;
+    }
+
+    // Wipe the evicted key schedule and expand the new one.
+    if (victimState == SLOT_IDLE)
+        clearSlot(victim);
+    if (!setSlotKey(victim, key, len)) {
+        clearSlot(victim);
+        lockCache();
+        clean(slots[victim]);
+        return false;
+    }
+    index = victim;
+    return true;
+}
+
+/**
+ * \brief Releases a slot that was acquired with acquireSlot().
+ *
+ * \param index The index of the slot to release.
+ */
+void KeyCacheCommon::releaseSlot(size_t index)
+{
+    lockCache();
+    if (index < count && slots[index].state == SLOT_IN_USE)
+        slots[index].state = SLOT_IDLE;
+}
+
+/**
+ * \brief Wipes every slot and cipher context before the cache is destroyed.
+ *
+ * Unlike clear(), this also wipes the slots that are currently acquired.
+ */
+void KeyCacheCommon::destroySlots()
+{
+    lockCache();
+    for (size_t index = 0; index < count; ++index) {
+        if (slots[index].state != SLOT_EMPTY)
+            clearSlot(index);
+        clean(slots[index]);
+    }
+}
+
+/**
+ * \fn void KeyCacheCommon::setSlots(Slot *slotInfo, size_t slotCount)
+ * \brief Sets the slots to use to hold the cached keys.
+ *
+ * \param slotInfo Points to the array of slots, which must be zeroed
+ * so that all of the slots start out empty.
+ * \param slotCount Number of slots in the array.
+ */
+
+/**
+ * \fn bool KeyCacheCommon::setSlotKey(size_t index, const uint8_t *key, size_t len)
+ * \brief Sets the key on the cipher context for a slot.
+ *
+ * \param index The index of the slot.
+ * \param key Points to the raw key.
+ * \param len Length of the raw \a key in bytes.
+ *
+ * \return Returns false if the key is not valid for the cipher.
+ */
+
+/**
+ * \fn void KeyCacheCommon::clearSlot(size_t index)
+ * \brief Clears the cipher context for a slot when its key is evicted.
+ *
+ * \param index The index of the slot.
+ */
+
+/**
+ * \class KeyCache KeyCache.h <KeyCache.h>
+ * \brief Bounded cache of cipher contexts that have already been keyed.
+ *
+ * Applications that handle many keys, such as a server talking to lots
+ * of devices, would otherwise need to expand the key schedule with
+ * setKey() for every message.  KeyCache holds up to N contexts of type T
+ * and hands out the one that already has the requested key, so that
+ * frequently used keys skip key expansion entirely.  When a new key is
+ * requested and the cache is full, the least recently used context is
+ * wiped with clear() and re-keyed.
+ *
+ * T can be any class that has "bool setKey(const uint8_t *key, size_t len)"
+ * and "void clear()" functions.  This includes the block ciphers, and also
+ * the modes built on top of them, which cache more of the per-key state;
+ * for example GCM also caches the GHASH key, EAX also caches the OMAC
+ * subkeys, and ChaChaPoly can be cached as well.
+ *
+ * \code
+ * KeyCache<GCM<AES256>, 16> cache;
+ *
+ * GCM<AES256> *gcm = cache.acquire(key, 32);
+ * if (gcm) {
+ *     gcm->setIV(iv, 12);
+ *     gcm->encrypt(ciphertext, plaintext, len);
+ *     gcm->computeTag(tag, 16);
+ *     cache.release(gcm);
+ * }
+ * \endcode
+ *
+ * Each context that is returned by acquire() belongs to the caller until
+ * it is passed to release().  Contexts are never shared between callers,
+ * so if two threads acquire the same key at once then they will get two
+ * different contexts.  acquire() returns NULL if all N contexts are in use.
+ *
+ * On Linux, Windows, and macOS hosts, the cache is protected by a mutex.
+ * The mutex is not held while a new key is being expanded.  The cache is
+ * not locked on microcontrollers, so callers that share a cache between
+ * RTOS tasks must serialize access to it themselves.
+ *
+ * The raw keys are held in the cache to confirm cache hits, and are
+ * wiped along with the cipher context when they are evicted.  Keys
+ * longer than 64 bytes cannot be cached.  Whether a key is in the cache
+ * or not is visible in the time taken by acquire(), so the cache should
+ * not be used if the timing of key lookups would reveal something sensitive.
+ *
+ * \sa KeyCacheCommon
+ */
+
+/**
+ * \fn KeyCache::KeyCache()
+ * \brief Constructs a new key cache with N empty slots.
+ */
+
+/**
+ * \fn KeyCache::~KeyCache()
+ * \brief Destroys this key cache after wiping all cached keys.
+ *
+ * Keys in contexts that are still acquired are wiped as well.
+ */
+
+/**
+ * \fn T *KeyCache::acquire(const void *key, size_t len)
+ * \brief Acquires a cipher context that has been set up with a specific key.
+ *
+ * \param key Points to the raw key.
+ * \param len Length of the raw \a key in bytes.
+ *
+ * \return Returns a pointer to the context, or NULL if \a len is too long,
+ * the key is not valid for T, or all contexts are currently in use.
+ *
+ * The caller must pass the context to release() when it is done with it.
+ * Per-message state, such as the IV for a cipher mode, must be set after
+ * each call to acquire() as it may have been left over from the last user.
+ *
+ * \sa release()
+ */
+
+/**
+ * \fn void KeyCache::release(T *object)
+ * \brief Releases a cipher context back into the cache.
+ *
+ * \param object The context that was returned by acquire().
+ *
+ * The key stays in the cache so that a later acquire() for the same key
+ * can reuse it.
+ *
+ * \sa acquire()
+ */
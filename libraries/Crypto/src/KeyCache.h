@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef CRYPTO_KEYCACHE_h
+#define CRYPTO_KEYCACHE_h
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+// Serialize access to the cache on hosted platforms that run more than
+// one thread.  Bare-metal toolchains such as arm-none-eabi may provide
+// <mutex> without declaring std::mutex, so it is not used on devices.
+#if defined(__linux__) || defined(_WIN32) || defined(__APPLE__)
+#define CRYPTO_KEY_CACHE_LOCKING 1
+#include <mutex>
+#endif
+
+// Largest raw key that can be cached; e.g. XTS<AES256> has 64-byte keys.
+#define KEY_CACHE_MAX_KEY_SIZE 64
+
+class KeyCacheCommon
+{
+public:
+    virtual ~KeyCacheCommon();
+
+    size_t capacity() const { return count; }
+
+    void clear();
+
+protected:
+    struct Slot
+    {
+        uint8_t key[KEY_CACHE_MAX_KEY_SIZE];
+        uint32_t hash;
+        uint32_t lastUsed;
+        uint8_t keyLen;
+        uint8_t state;
+    };
+
+    KeyCacheCommon();
+    void setSlots(Slot *slotInfo, size_t slotCount)
+    {
+        slots = slotInfo;
+        count = slotCount;
+    }
+
+    bool acquireSlot(size_t &index, const uint8_t *key, size_t len);
+    void releaseSlot(size_t index);
+    void destroySlots();
+
+    virtual bool setSlotKey(size_t index, const uint8_t *key, size_t len) = 0;
+    virtual void clearSlot(size_t index) = 0;
+
+private:
+    Slot *slots;
+    size_t count;
+    uint32_t useCounter;
+#if defined(CRYPTO_KEY_CACHE_LOCKING)
+    std::mutex mutex;
+#endif
+};
+
+template <typename T, size_t N>
+class KeyCache : public KeyCacheCommon
+{
+public:
+    KeyCache()
+    {
+        memset(slotInfo, 0, sizeof(slotInfo));
+        setSlots(slotInfo, N);
+    }
+    ~KeyCache() { destroySlots(); }
+
+    T *acquire(const void *key, size_t len)
+    {
+        size_t index;
+        if (!acquireSlot(index, (const uint8_t *)key, len))
+            return 0;
+        return &(objects[index]);
+    }
+
+    void release(T *object) { releaseSlot((size_t)(object - objects)); }
+
+protected:
+    bool setSlotKey(size_t index, const uint8_t *key, size_t len)
+    {
+        return objects[index].setKey(key, len);
+    }
+    void clearSlot(size_t index) { objects[index].clear(); }
+
+private:
+    Slot slotInfo[N];
+    T objects[N];
+};
+
+#endif
@@ -58,7 +58,9 @@ OMAC::OMAC()
  */
 OMAC::~OMAC()
 {
+    clean(l);
     clean(b);
+    clean(p);
 }
 
 /**
@@ -78,6 +80,30 @@ OMAC::~OMAC()
  * \sa blockCipher()
  */
 
+/**
+ * \brief Derives the L, B, and P values for OMAC from the current key.
+ *
+ * The three values depend only upon the key, so they are cached in
+ * this object and reused by restartFirst() and finalize() for every
+ * message under the same key.  It is assumed that setBlockCipher()
+ * has already been called and that the block cipher has a key.
+ *
+ * This function must be called again whenever the block cipher or the
+ * key changes.
+ *
+ * \sa initFirst(), restartFirst()
+ */
+void OMAC::initKey()
+{
+    // L is the encryption of a block of zeroes, B = 2 * L, and P = 4 * L.
+    memset(l, 0, 16);
+    _blockCipher->encryptBlock((uint8_t *)l, (const uint8_t *)l);
+    memcpy(b, l, 16);
+    GF128::dblEAX(b);
+    memcpy(p, b, 16);
+    GF128::dblEAX(p);
+}
+
 /**
  * \brief Initialises the first OMAC hashing context and creates the B value.
  *
@@ -94,23 +120,34 @@ OMAC::~OMAC()
  * can be called to restart the context with a specific tag.
  *
  * This function must be called again whenever the block cipher or the
- * key changes.
+ * key changes.  It is equivalent to initKey() followed by restartFirst().
  *
- * \sa initNext(), update(), finalize()
+ * \sa initNext(), update(), finalize(), restartFirst()
  */
 void OMAC::initFirst(uint8_t omac[16])
 {
-    // Start the OMAC context.  We assume that the data that follows
-    // will be at least 1 byte in length so that we can encrypt the
-    // zeroes now to derive the B value.
-    memset(omac, 0, 16);
-    _blockCipher->encryptBlock(omac, omac);
-    posn = 0;
+    initKey();
+    restartFirst(omac);
+}
 
-    // Generate the B value from the encrypted block of zeroes.
-    // We will need this later when finalising the OMAC hashes.
-    memcpy(b, omac, 16);
-    GF128::dblEAX(b);
+/**
+ * \brief Restarts the first OMAC hashing context using the cached values
+ * from a previous call to initKey() or initFirst().
+ *
+ * \param omac The OMAC hashing context.
+ *
+ * This is the same as initFirst() except that the block cipher is not
+ * used, which makes it cheaper to start a new message under the same key.
+ *
+ * \sa initFirst(), initKey()
+ */
+void OMAC::restartFirst(uint8_t omac[16])
+{
+    // The first block of data is implicitly zero, so the context after
+    // the first block is simply the encrypted block of zeroes, L.  We assume
+    // that the data that follows will be at least 1 byte in length.
+    memcpy(omac, l, 16);
+    posn = 0;
 }
 
 /**
@@ -174,13 +211,9 @@ void OMAC::finalize(uint8_t omac[16])
     // Apply padding if necessary.
     if (posn != 16) {
         // Need padding: XOR with P = 2 * B.
-        uint32_t p[4];
-        memcpy(p, b, 16);
-        GF128::dblEAX(p);
         omac[posn] ^= 0x80;
         for (uint8_t index = 0; index < 16; ++index)
             omac[index] ^= ((const uint8_t *)p)[index];
-        clean(p);
     } else {
         // No padding necessary: XOR with B.
         for (uint8_t index = 0; index < 16; ++index)
@@ -196,5 +229,7 @@ void OMAC::finalize(uint8_t omac[16])
  */
 void OMAC::clear()
 {
+    clean(l);
     clean(b);
+    clean(p);
 }
@@ -34,7 +34,9 @@ public:
     BlockCipher *blockCipher() const { return _blockCipher; }
     void setBlockCipher(BlockCipher *cipher) { _blockCipher = cipher; }
 
+    void initKey();
     void initFirst(uint8_t omac[16]);
+    void restartFirst(uint8_t omac[16]);
     void initNext(uint8_t omac[16], uint8_t tag);
     void update(uint8_t omac[16], const uint8_t *data, size_t size);
     void finalize(uint8_t omac[16]);
@@ -43,7 +45,9 @@ public:
 
 private:
     BlockCipher *_blockCipher;
+    uint32_t l[4];
     uint32_t b[4];
+    uint32_t p[4];
     uint8_t posn;
 };
 
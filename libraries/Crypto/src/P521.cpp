@@ -35,7 +35,12 @@
  *
  * \note The public functions in this class need a substantial amount of
  * stack space to store intermediate results while the curve function is
- * being evaluated.  About 2k of free stack space is recommended for safety.
+ * being evaluated.  About 2k of free stack space is recommended for safety
+ * on 8-bit and 16-bit platforms.  32-bit and 64-bit platforms use a larger
+ * table of precomputed multiples to speed up the curve function and need
+ * about 4k and 6k of free stack space respectively.  verify() needs about
+ * 1k more than the other functions on all platforms to hold the recoded
+ * forms of its two scalars.
  *
  * References: NIST FIPS 186-4,
  * <a href="http://tools.ietf.org/html/rfc6090">RFC 6090</a>,
@@ -71,6 +76,38 @@
 #define LIMB_PARTIAL(value) (value)
 #endif
 
+// Number of scalar bits to process at a time in evaluate().  Larger
+// windows need fewer point additions but more stack space to hold the
+// table of small multiples of the point, so scale the window with the
+// limb size which is a rough guide to how much memory the platform has.
+#if BIGNUMBER_LIMB_64BIT
+#define P521_WINDOW_BITS    4
+#elif BIGNUMBER_LIMB_32BIT
+#define P521_WINDOW_BITS    3
+#else
+#define P521_WINDOW_BITS    2
+#endif
+#define P521_WINDOW_SIZE    (1 << P521_WINDOW_BITS)
+
+// Number of windows that are needed to cover a 521-bit scalar.
+#define P521_NUM_WINDOWS    ((521 + P521_WINDOW_BITS - 1) / P521_WINDOW_BITS)
+
+// Parameters for the fixed comb that is used to multiply the generator G.
+// The 521-bit scalar is split into P521_COMB_TEETH blocks of
+// P521_COMB_SPACING bits and one bit is taken from each block at a time.
+#define P521_COMB_TEETH     5
+#define P521_COMB_SPACING   105
+#define P521_COMB_SIZE      ((1 << P521_COMB_TEETH) - 1)
+
+// Window widths for the variable-time wNAF multiplication in verify().
+// The odd multiples of G come from a fixed table and the odd multiples
+// of the public key are computed on the fly.
+#define P521_WNAF_G_BITS    5
+#define P521_WNAF_G_SIZE    (1 << (P521_WNAF_G_BITS - 2))
+#define P521_WNAF_Q_BITS    4
+#define P521_WNAF_Q_SIZE    (1 << (P521_WNAF_Q_BITS - 2))
+#define P521_WNAF_DIGITS    522
+
 /** @cond */
 
 // The group order "q" value from RFC 4754 and RFC 5903.  This is the
@@ -110,6 +147,407 @@ static limb_t const P521_Gy[NUM_LIMBS_521BIT] PROGMEM = {
     LIMB_PARTIAL(0x118)
 };
 
+// Comb table for multiplying the generator G.  Entry i - 1 holds the
+// affine point (x, y) for (b0 + b1 * 2^105 + ... + b4 * 2^420) * G where
+// b0 ... b4 are the bits of i from lowest to highest.  Entry 0 is G.
+static limb_t const P521_comb[P521_COMB_SIZE][2][NUM_LIMBS_521BIT] PROGMEM = {
+    {{LIMB_PAIR(0xc2e5bd66, 0xf97e7e31), LIMB_PAIR(0x856a429b, 0x3348b3c1),
+      LIMB_PAIR(0xa2ffa8de, 0xfe1dc127), LIMB_PAIR(0xefe75928, 0xa14b5e77),
+      LIMB_PAIR(0x6b4d3dba, 0xf828af60), LIMB_PAIR(0x053fb521, 0x9c648139),
+      LIMB_PAIR(0x2395b442, 0x9e3ecb66), LIMB_PAIR(0x0404e9cd, 0x858e06b7),
+      LIMB_PARTIAL(0x0c6)},
+     {LIMB_PAIR(0x9fd16650, 0x88be9476), LIMB_PAIR(0xa272c240, 0x353c7086),
+      LIMB_PAIR(0x3fad0761, 0xc550b901), LIMB_PAIR(0x5ef42640, 0x97ee7299),
+      LIMB_PAIR(0x273e662c, 0x17afbd17), LIMB_PAIR(0x579b4468, 0x98f54449),
+      LIMB_PAIR(0x2c7d1bd9, 0x5c8a5fb4), LIMB_PAIR(0x9a3bc004, 0x39296a78),
+      LIMB_PARTIAL(0x118)}},
+    {{LIMB_PAIR(0x876b33ac, 0x45d90cf8), LIMB_PAIR(0x3ed58f0b, 0xe53e1a99),
+      LIMB_PAIR(0x49d916b3, 0xd5d181f5), LIMB_PAIR(0x2ec09be2, 0x1b1ef040),
+      LIMB_PAIR(0xb2113b57, 0xe5787176), LIMB_PAIR(0x8073044e, 0x11d02e70),
+      LIMB_PAIR(0xa2ae38dd, 0x9d1c19e7), LIMB_PAIR(0x3634f6fa, 0x2662d494),
+      LIMB_PARTIAL(0x130)},
+     {LIMB_PAIR(0x6bd6208e, 0x454c8a73), LIMB_PAIR(0xae37911a, 0xd2447cef),
+      LIMB_PAIR(0x69b8c5ae, 0x56ac592e), LIMB_PAIR(0x9b615bfc, 0xe7f56483),
+      LIMB_PAIR(0xbbe7fe62, 0xfac066e1), LIMB_PAIR(0xb7777b32, 0xb2ac3ee1),
+      LIMB_PAIR(0x15114ada, 0x55f86533), LIMB_PAIR(0x46497cc9, 0x15cba83e),
+      LIMB_PARTIAL(0x1ef)}},
+    {{LIMB_PAIR(0xe371375d, 0x863b3adb), LIMB_PAIR(0x89cf187b, 0xf2ddd842),
+      LIMB_PAIR(0x6ab24b10, 0x80cf70e7), LIMB_PAIR(0x57d81a93, 0x78063ae6),
+      LIMB_PAIR(0xc87491c5, 0x88aeb0b1), LIMB_PAIR(0x2e17fbf9, 0x5ebe733a),
+      LIMB_PAIR(0x52ad31ba, 0xc205cbcd), LIMB_PAIR(0xed66a7f8, 0xa13230f9),
+      LIMB_PARTIAL(0x117)},
+     {LIMB_PAIR(0x03a6ec5d, 0x224d9a3b), LIMB_PAIR(0xbe627be3, 0xe1efca41),
+      LIMB_PAIR(0x22abca89, 0x34df229c), LIMB_PAIR(0x8153b848, 0x11c526a0),
+      LIMB_PAIR(0xcbb59e96, 0x26879bd9), LIMB_PAIR(0x8d1298ed, 0x77eccc36),
+      LIMB_PAIR(0xd6560f21, 0xaf68677b), LIMB_PAIR(0x242b365b, 0xe5ddc615),
+      LIMB_PARTIAL(0x17f)}},
+    {{LIMB_PAIR(0x155c337b, 0x7eaefe12), LIMB_PAIR(0xc7186596, 0x357f27ce),
+      LIMB_PAIR(0x654dbbeb, 0x90c26c69), LIMB_PAIR(0xa1b63a6a, 0x6bcca278),
+      LIMB_PAIR(0x8edd9123, 0x776b7a92), LIMB_PAIR(0x6c6da5e9, 0xb2bef507),
+      LIMB_PAIR(0x0e3c747b, 0x805ed3aa), LIMB_PAIR(0x659df2ef, 0x298ef458),
+      LIMB_PARTIAL(0x098)},
+     {LIMB_PAIR(0x35a79f8d, 0xe3dd8939), LIMB_PAIR(0xa1972c6b, 0x672b109c),
+      LIMB_PAIR(0x07953a4d, 0xad41cbae), LIMB_PAIR(0xd206de77, 0xde07527f),
+      LIMB_PAIR(0xb61d9811, 0x1f55a4c0), LIMB_PAIR(0x7a75360e, 0x929d56d5),
+      LIMB_PAIR(0x5032efe6, 0x9f2becff), LIMB_PAIR(0x60f0622c, 0x0de654c7),
+      LIMB_PARTIAL(0x018)}},
+    {{LIMB_PAIR(0x8445216b, 0xd9e465af), LIMB_PAIR(0xc57ae51b, 0x7d12c12b),
+      LIMB_PAIR(0xab01f4d2, 0xaf65fd9b), LIMB_PAIR(0xb3c1d722, 0xf2fd8a84),
+      LIMB_PAIR(0xf5123832, 0x8870dc27), LIMB_PAIR(0x8c85325e, 0xe8b51d16),
+      LIMB_PAIR(0x92e31759, 0x1a03d5df), LIMB_PAIR(0xefdb49c3, 0x7b5e6c46),
+      LIMB_PARTIAL(0x05e)},
+     {LIMB_PAIR(0x137a651a, 0xb427174d), LIMB_PAIR(0x256229cb, 0xf9e661d4),
+      LIMB_PAIR(0xed3aeb3f, 0xbbd04d0f), LIMB_PAIR(0x5bb3fae1, 0xc31eef45),
+      LIMB_PAIR(0x07a35089, 0x52df99e4), LIMB_PAIR(0xed429e1a, 0x6514b9bd),
+      LIMB_PAIR(0x67ecbd97, 0x757977bf), LIMB_PAIR(0xb2725c6d, 0x70a2b55f),
+      LIMB_PARTIAL(0x0a7)}},
+    {{LIMB_PAIR(0x8913355a, 0xdd2cd8ae), LIMB_PAIR(0xba2f3522, 0x02114bfc),
+      LIMB_PAIR(0x22446abf, 0xe62184f5), LIMB_PAIR(0x68e6d0c5, 0xe8d75651),
+      LIMB_PAIR(0x19ad9ebc, 0x580f6c03), LIMB_PAIR(0xc2953557, 0x8b9d5d55),
+      LIMB_PAIR(0x618534df, 0x234640a5), LIMB_PAIR(0xfed9e6b6, 0xf452a772),
+      LIMB_PARTIAL(0x1b7)},
+     {LIMB_PAIR(0x16211bb5, 0x0952e477), LIMB_PAIR(0x5cedf594, 0xd3d874ae),
+      LIMB_PAIR(0x85328765, 0x2c21a7bd), LIMB_PAIR(0xec333d98, 0x44b3033c),
+      LIMB_PAIR(0x3c587cd5, 0x0474258d), LIMB_PAIR(0x4962e19e, 0x527c162f),
+      LIMB_PAIR(0x5b356dd3, 0x0dbf0f7a), LIMB_PAIR(0x95bbfc9b, 0x8d683b71),
+      LIMB_PARTIAL(0x1bc)}},
+    {{LIMB_PAIR(0x94bb174c, 0xff99f7cd), LIMB_PAIR(0x96566e5e, 0x905b42bd),
+      LIMB_PAIR(0xebae3baa, 0xda1abf35), LIMB_PAIR(0x7644ce21, 0x15ddf71b),
+      LIMB_PAIR(0x50e83a0c, 0x2920c1c0), LIMB_PAIR(0x0f7b1973, 0x237776ed),
+      LIMB_PAIR(0x57adf3a6, 0x7e393449), LIMB_PAIR(0x9160ead0, 0xd9e08cf9),
+      LIMB_PARTIAL(0x100)},
+     {LIMB_PAIR(0x675707da, 0x54f0135e), LIMB_PAIR(0x2e5596b0, 0x5976788e),
+      LIMB_PAIR(0xf3ac4001, 0x73dd4b88), LIMB_PAIR(0xfbacbfe7, 0x7f5453e3),
+      LIMB_PAIR(0x426b2080, 0x551dc249), LIMB_PAIR(0xe33f8f92, 0x528ff571),
+      LIMB_PAIR(0x95834f88, 0xd78d1e40), LIMB_PAIR(0x7d07a77c, 0x20405c91),
+      LIMB_PARTIAL(0x114)}},
+    {{LIMB_PAIR(0xec3d1383, 0xd1ce126e), LIMB_PAIR(0x4805b18e, 0x0c7f980a),
+      LIMB_PAIR(0xfc1b1f4e, 0x65945086), LIMB_PAIR(0x092e0ca0, 0xac1703ae),
+      LIMB_PAIR(0x8b5ee5c0, 0x834c77f9), LIMB_PAIR(0x6d19fbb5, 0x3e722f57),
+      LIMB_PAIR(0xf6770bd1, 0xae8a944a), LIMB_PAIR(0x2a7c7101, 0xe1d11050),
+      LIMB_PARTIAL(0x0d7)},
+     {LIMB_PAIR(0xca303000, 0x62029fd2), LIMB_PAIR(0xacb52ecd, 0x366c72c9),
+      LIMB_PAIR(0xcc8dd8a2, 0xcf89c1aa), LIMB_PAIR(0x5d1b984d, 0x95c235bf),
+      LIMB_PAIR(0xd1a80d52, 0x3434d10d), LIMB_PAIR(0x77e95add, 0x094d0a8f),
+      LIMB_PAIR(0xd1203660, 0x03890027), LIMB_PAIR(0x29791ab3, 0x32faf273),
+      LIMB_PARTIAL(0x075)}},
+    {{LIMB_PAIR(0x075a4208, 0x9281b5c1), LIMB_PAIR(0x471c7fcc, 0xafc5e0e5),
+      LIMB_PAIR(0xc8704f00, 0x9a6e82f3), LIMB_PAIR(0x62960946, 0x4320c31a),
+      LIMB_PAIR(0x513c571f, 0xe673b4bd), LIMB_PAIR(0x3dc4d8fb, 0x9b68532a),
+      LIMB_PAIR(0x2c95dbe9, 0xa8cbe344), LIMB_PAIR(0x229c47b7, 0x0f6ac257),
+      LIMB_PARTIAL(0x14a)},
+     {LIMB_PAIR(0xc1411542, 0x1b4c092d), LIMB_PAIR(0x7747beaf, 0xc4bb45d6),
+      LIMB_PAIR(0x8d55735e, 0x685c4be4), LIMB_PAIR(0x6383fd44, 0x9e72fcc8),
+      LIMB_PAIR(0x203ff740, 0x615bdc52), LIMB_PAIR(0x5b1a64ad, 0xcc19dafb),
+      LIMB_PAIR(0x2b782e96, 0x28ef0d34), LIMB_PAIR(0x05e3ae87, 0x21d84532),
+      LIMB_PARTIAL(0x052)}},
+    {{LIMB_PAIR(0x72656971, 0x6a884570), LIMB_PAIR(0xa7f20efe, 0xdc4fcb92),
+      LIMB_PAIR(0xdc31417c, 0x759db4ff), LIMB_PAIR(0xf95dc14f, 0xf1bf0345),
+      LIMB_PAIR(0x0fd656f0, 0x0686bd5b), LIMB_PAIR(0x6f4440f7, 0x9c5ea036),
+      LIMB_PAIR(0x3887f6e1, 0x207619ce), LIMB_PAIR(0xa211de2d, 0xa9ef8d60),
+      LIMB_PARTIAL(0x07d)},
+     {LIMB_PAIR(0x8e5a6c11, 0xd0bce7f9), LIMB_PAIR(0xedc82b6c, 0xab338406),
+      LIMB_PAIR(0x7cb589b2, 0x36726a50), LIMB_PAIR(0x02cc7eb7, 0x887b6cfc),
+      LIMB_PAIR(0x28ace2ab, 0x651f7903), LIMB_PAIR(0x06ba6057, 0x8e7f8436),
+      LIMB_PAIR(0xbff72afe, 0xd103b1b2), LIMB_PAIR(0x46959145, 0x942cf0c6),
+      LIMB_PARTIAL(0x033)}},
+    {{LIMB_PAIR(0x5805d03e, 0x204b0833), LIMB_PAIR(0x5a1ab8cf, 0x3c03ae7a),
+      LIMB_PAIR(0xead6f888, 0x3376e27b), LIMB_PAIR(0x94a53e60, 0xb0e6713a),
+      LIMB_PAIR(0x3f0b8ee9, 0x790f9e81), LIMB_PAIR(0x4b4896e3, 0x21b2ac27),
+      LIMB_PAIR(0xe7fafecc, 0xce7c291b), LIMB_PAIR(0x1c1049ca, 0x10fe14a2),
+      LIMB_PARTIAL(0x04d)},
+     {LIMB_PAIR(0xd2130d68, 0x95bb30a7), LIMB_PAIR(0x4c891468, 0xc2a8f2a5),
+      LIMB_PAIR(0xb1608a4a, 0x5236ae15), LIMB_PAIR(0xc50f2485, 0xbd832829),
+      LIMB_PAIR(0x435254ed, 0xc87af748), LIMB_PAIR(0x3a80dc29, 0xc76d7df6),
+      LIMB_PAIR(0x5d881936, 0x7ce57b49), LIMB_PAIR(0xc0aeaa0d, 0x8e95cb82),
+      LIMB_PARTIAL(0x17f)}},
+    {{LIMB_PAIR(0x829a40a3, 0x21a193c7), LIMB_PAIR(0x05f32f41, 0x87b759a9),
+      LIMB_PAIR(0x6e143537, 0xba154763), LIMB_PAIR(0x6b5a6433, 0xfb951864),
+      LIMB_PAIR(0xd8e9be43, 0x81c1dadf), LIMB_PAIR(0xb5173d47, 0x3145a42c),
+      LIMB_PAIR(0xe5c9b799, 0x22d5ef4b), LIMB_PAIR(0xffe36ee4, 0x0bde5942),
+      LIMB_PARTIAL(0x10a)},
+     {LIMB_PAIR(0xf4bc58e5, 0xafc83ba5), LIMB_PAIR(0xd58698e3, 0xb418e478),
+      LIMB_PAIR(0x1726d889, 0x1f60371a), LIMB_PAIR(0x2f0a291a, 0xa5a58b57),
+      LIMB_PAIR(0xfd356626, 0x0e44da0a), LIMB_PAIR(0x2d89342f, 0xa3e9be34),
+      LIMB_PAIR(0xc3c1b4a2, 0x9195921b), LIMB_PAIR(0x25e4191e, 0xbcb21228),
+      LIMB_PARTIAL(0x135)}},
+    {{LIMB_PAIR(0x0eba209a, 0xa1b5f88d), LIMB_PAIR(0x3c5e2880, 0x04b54668),
+      LIMB_PAIR(0xefbb25f1, 0xe93591a0), LIMB_PAIR(0xe9729982, 0x1678d5f7),
+      LIMB_PAIR(0x7d430831, 0x6eb992da), LIMB_PAIR(0x0b7c198f, 0x1a4a91f7),
+      LIMB_PAIR(0x6ed1ff3e, 0x3a679847), LIMB_PAIR(0x5465e131, 0x18a5e132),
+      LIMB_PARTIAL(0x042)},
+     {LIMB_PAIR(0x59486fc8, 0xaf8471eb), LIMB_PAIR(0x9b6ab9e2, 0x397d8cab),
+      LIMB_PAIR(0x10c0f9ea, 0x942279c2), LIMB_PAIR(0xdddf11b9, 0xb3186547),
+      LIMB_PAIR(0x7e0e49b0, 0x2910861a), LIMB_PAIR(0x4c374108, 0x0ac066ab),
+      LIMB_PAIR(0x9c34f007, 0x67c76f4c), LIMB_PAIR(0x6a9e031f, 0x3635edbe),
+      LIMB_PARTIAL(0x0f7)}},
+    {{LIMB_PAIR(0x4ccfa596, 0x2e91929f), LIMB_PAIR(0x844098cf, 0x3b168733),
+      LIMB_PAIR(0x616a36df, 0x0fea437e), LIMB_PAIR(0xe0dc39ae, 0xbea5755d),
+      LIMB_PAIR(0xca20c73a, 0x721050e6), LIMB_PAIR(0xa6534de2, 0x5d86bb64),
+      LIMB_PAIR(0xaf758aef, 0x0c65ff4f), LIMB_PAIR(0x33832cca, 0x38d7bd4d),
+      LIMB_PARTIAL(0x127)},
+     {LIMB_PAIR(0xf7b22fc2, 0xaabe7e25), LIMB_PAIR(0x138537be, 0x44ec7b6e),
+      LIMB_PAIR(0x5ad7c324, 0x33cd05c9), LIMB_PAIR(0xc1602459, 0x28a6115c),
+      LIMB_PAIR(0xdf229461, 0x05c1aa34), LIMB_PAIR(0xbdb1d24d, 0x39fc35d8),
+      LIMB_PAIR(0x4b5f6223, 0x536aa0d5), LIMB_PAIR(0x703bd0f3, 0x1d5287e3),
+      LIMB_PARTIAL(0x186)}},
+    {{LIMB_PAIR(0x5e6a7807, 0x9f9a072d), LIMB_PAIR(0x39eeb105, 0xf9a38a83),
+      LIMB_PAIR(0x17ddb1b4, 0x1503495f), LIMB_PAIR(0x732310b4, 0xda780a6c),
+      LIMB_PAIR(0x403a5d57, 0x7b287813), LIMB_PAIR(0xe7c481e7, 0x6bb08815),
+      LIMB_PAIR(0x574c23e2, 0x1198c8a4), LIMB_PAIR(0x673dfc44, 0xa8da92a4),
+      LIMB_PARTIAL(0x02a)},
+     {LIMB_PAIR(0xbfb7ce31, 0x92df33ae), LIMB_PAIR(0x4a686f13, 0x1648e528),
+      LIMB_PAIR(0xe45ba7f2, 0x4429b3af), LIMB_PAIR(0x397c1d83, 0x216c5137),
+      LIMB_PAIR(0xc8c8ee26, 0xcac9d3c3), LIMB_PAIR(0x40c73424, 0x0711605e),
+      LIMB_PAIR(0x219c8c3f, 0x008b93a5), LIMB_PAIR(0xc6f10bb3, 0xab1ee7b8),
+      LIMB_PARTIAL(0x0e0)}},
+    {{LIMB_PAIR(0x10a8c4fb, 0x73a6ba38), LIMB_PAIR(0xecc93e5d, 0x5153d959),
+      LIMB_PAIR(0xb59e9871, 0x7ca58012), LIMB_PAIR(0xafd442f1, 0xedc0dbef),
+      LIMB_PAIR(0xb9cf7691, 0xb9050a22), LIMB_PAIR(0x464d017d, 0x3d1e96fe),
+      LIMB_PAIR(0x82074dca, 0x541781a4), LIMB_PAIR(0x8b355413, 0xedce0db3),
+      LIMB_PARTIAL(0x06b)},
+     {LIMB_PAIR(0xae2b39c2, 0x1a13e3ee), LIMB_PAIR(0x3c218179, 0xc431081d),
+      LIMB_PAIR(0xae68b7c6, 0x5cbc14c1), LIMB_PAIR(0x9005a304, 0xcf2559bb),
+      LIMB_PAIR(0x2ec7aed5, 0x14d7c1e9), LIMB_PAIR(0x1e2e2f0d, 0x5c379bfe),
+      LIMB_PAIR(0x886f0cf9, 0xfc33e4d2), LIMB_PAIR(0xac4e1d17, 0x2f14e7d0),
+      LIMB_PARTIAL(0x071)}},
+    {{LIMB_PAIR(0xedde488a, 0x2f1f1497), LIMB_PAIR(0x31ee698e, 0x3d0364b2),
+      LIMB_PAIR(0xa47e048e, 0x88a32c39), LIMB_PAIR(0x86da37c4, 0x80abd8de),
+      LIMB_PAIR(0x07895c9c, 0x6608eed9), LIMB_PAIR(0xd18a7081, 0xcca6b9e6),
+      LIMB_PAIR(0x0ca87303, 0x44f63aa9), LIMB_PAIR(0x094f9789, 0x84281eed),
+      LIMB_PARTIAL(0x17f)},
+     {LIMB_PAIR(0x6aa5f7a3, 0x5703727d), LIMB_PAIR(0x09da94a2, 0xd9c33512),
+      LIMB_PAIR(0xaddccfd6, 0x80572f9e), LIMB_PAIR(0x45febcc1, 0xf95bf8b0),
+      LIMB_PAIR(0x30a48dac, 0x4bcd4b12), LIMB_PAIR(0xf00f8619, 0x32a16a21),
+      LIMB_PAIR(0x1bcad341, 0x612d82b9), LIMB_PAIR(0xe2babc4a, 0xf42138da),
+      LIMB_PARTIAL(0x14b)}},
+    {{LIMB_PAIR(0x1510e086, 0x7e9364ea), LIMB_PAIR(0x31d0f679, 0x524b63b1),
+      LIMB_PAIR(0x9aeae146, 0xf8f3cc52), LIMB_PAIR(0x36f90818, 0x8c05c88d),
+      LIMB_PAIR(0x80d7dab5, 0x16ed75e5), LIMB_PAIR(0x54000c49, 0x8f872700),
+      LIMB_PAIR(0x843c5f7a, 0x9740a2a1), LIMB_PAIR(0x6e680411, 0x8dc46ac5),
+      LIMB_PARTIAL(0x0d8)},
+     {LIMB_PAIR(0xbac1fcbc, 0x9492a1d6), LIMB_PAIR(0x8a9ca207, 0xcd7cd811),
+      LIMB_PAIR(0xcded0753, 0xd61403a1), LIMB_PAIR(0x6702b3fa, 0x2d232e49),
+      LIMB_PAIR(0x83e33229, 0x5bd01fc9), LIMB_PAIR(0x4dbe98f9, 0x157c427c),
+      LIMB_PAIR(0x1c5b4229, 0xd2594a9f), LIMB_PAIR(0xe6318047, 0xe0207b85),
+      LIMB_PARTIAL(0x1f5)}},
+    {{LIMB_PAIR(0x71aaef75, 0x6bf98381), LIMB_PAIR(0xc14b076a, 0x479cc2a8),
+      LIMB_PAIR(0xcc783dc5, 0xc0466ec4), LIMB_PAIR(0x682e48f9, 0x7f120da2),
+      LIMB_PAIR(0x4a4ed12f, 0xe02258ac), LIMB_PAIR(0x83da05ed, 0x8d8ab9b9),
+      LIMB_PAIR(0x394701b0, 0xb1b1ec54), LIMB_PAIR(0x82d2c76e, 0x8fc99926),
+      LIMB_PARTIAL(0x079)},
+     {LIMB_PAIR(0x96c5465a, 0x0a611bf4), LIMB_PAIR(0x74f20f8f, 0xd0a6b210),
+      LIMB_PAIR(0xb7200111, 0x2178f283), LIMB_PAIR(0x48705a27, 0xbd71855c),
+      LIMB_PAIR(0xe797aa46, 0x204b17eb), LIMB_PAIR(0x1a418c95, 0x8200553c),
+      LIMB_PAIR(0x7c5363e9, 0x0ac39a6a), LIMB_PAIR(0x38e587ec, 0x41e58ba1),
+      LIMB_PARTIAL(0x092)}},
+    {{LIMB_PAIR(0xd580c2bf, 0x7a1128d3), LIMB_PAIR(0x33cb48ff, 0x54cb80b9),
+      LIMB_PAIR(0x124988a8, 0x12e00e24), LIMB_PAIR(0x8973b0b6, 0x2e41bd3e),
+      LIMB_PAIR(0x0729f811, 0x81f9b249), LIMB_PAIR(0x0b26f7d0, 0x82b1e837),
+      LIMB_PAIR(0x453d977e, 0x66102520), LIMB_PAIR(0x76af2ff3, 0x86404fbf),
+      LIMB_PARTIAL(0x122)},
+     {LIMB_PAIR(0xda706520, 0x935eed87), LIMB_PAIR(0x72990fdc, 0x35aeff20),
+      LIMB_PAIR(0x75f99b1d, 0xf65cfb16), LIMB_PAIR(0x8369d686, 0x0e6d254d),
+      LIMB_PAIR(0x0882827e, 0xc3493c5e), LIMB_PAIR(0x4f166119, 0xa0edf2da),
+      LIMB_PAIR(0x59363a25, 0x7638d201), LIMB_PAIR(0x76088e6b, 0xece18042),
+      LIMB_PARTIAL(0x138)}},
+    {{LIMB_PAIR(0xf8913cc2, 0x02fb999b), LIMB_PAIR(0xc961f4d7, 0x81688347),
+      LIMB_PAIR(0x8d0435c3, 0xd54c91f7), LIMB_PAIR(0x990e6ab3, 0xcbd0bcca),
+      LIMB_PAIR(0xd848398a, 0x3c8bce08), LIMB_PAIR(0xd5370ed6, 0x83f3f979),
+      LIMB_PAIR(0x74fd3ac3, 0x7449bbd2), LIMB_PAIR(0x4e73cfaa, 0xe6145db8),
+      LIMB_PARTIAL(0x15e)},
+     {LIMB_PAIR(0x58044777, 0x8a435e24), LIMB_PAIR(0x937e7687, 0x29b9d279),
+      LIMB_PAIR(0xe44d2874, 0x42c2e303), LIMB_PAIR(0x9845f55f, 0xfde623ca),
+      LIMB_PAIR(0x2fa1bc3e, 0x752c258f), LIMB_PAIR(0xce8a096a, 0x198db2b3),
+      LIMB_PAIR(0x6f2ec50f, 0x59b5361b), LIMB_PAIR(0x1a2aa43f, 0x5a4f209c),
+      LIMB_PARTIAL(0x14a)}},
+    {{LIMB_PAIR(0x4f005da0, 0xfcbb48b5), LIMB_PAIR(0x50cbc0c5, 0x2a8d3120),
+      LIMB_PAIR(0xe9ac811d, 0xb33c1526), LIMB_PAIR(0x586013f2, 0x91e493ce),
+      LIMB_PAIR(0x488d1688, 0x99412264), LIMB_PAIR(0x875c45e1, 0x7966c1c1),
+      LIMB_PAIR(0xbe0d5b72, 0x9dbc86d2), LIMB_PAIR(0x1553d029, 0x63a83498),
+      LIMB_PARTIAL(0x068)},
+     {LIMB_PAIR(0x9d44055b, 0x184f3300), LIMB_PAIR(0xd232a2f5, 0xadbec2bb),
+      LIMB_PAIR(0x5a2a5eb5, 0x4e0b32a8), LIMB_PAIR(0xe3535f4c, 0x938d776c),
+      LIMB_PAIR(0x0f169cf8, 0xd2591a1a), LIMB_PAIR(0xe7a2093d, 0x8dca29f4),
+      LIMB_PAIR(0x145f902b, 0xb8746330), LIMB_PAIR(0xfe2cebec, 0x816d6f86),
+      LIMB_PARTIAL(0x068)}},
+    {{LIMB_PAIR(0x2a7fabd6, 0x5b774088), LIMB_PAIR(0x826f236e, 0x0911e7f0),
+      LIMB_PAIR(0x84f0bbd3, 0xbc4d014c), LIMB_PAIR(0x2e000c1a, 0x0b8bcd8f),
+      LIMB_PAIR(0x2ddeb721, 0xd5ff7778), LIMB_PAIR(0x7ef826a9, 0x0f7a76f9),
+      LIMB_PAIR(0x644d2f94, 0x031ce26f), LIMB_PAIR(0x78fdc7ed, 0x1eafdc82),
+      LIMB_PARTIAL(0x1e2)},
+     {LIMB_PAIR(0xa60bc2a1, 0x16bf1952), LIMB_PAIR(0x3dd7dcd5, 0x2ce4110c),
+      LIMB_PAIR(0x78e260c3, 0x3df02bf1), LIMB_PAIR(0x3944b29c, 0x132208c2),
+      LIMB_PAIR(0x59682e01, 0x13add246), LIMB_PAIR(0x133b08c5, 0x87922b46),
+      LIMB_PAIR(0x51c7aea4, 0x5b3e4932), LIMB_PAIR(0x9380bdff, 0x9e77c83b),
+      LIMB_PARTIAL(0x0e0)}},
+    {{LIMB_PAIR(0x54746586, 0x3ce44040), LIMB_PAIR(0x31e2cb31, 0x5260f1be),
+      LIMB_PAIR(0x1c0a1dc6, 0x802e6890), LIMB_PAIR(0xf84363bb, 0x5e9aaea8),
+      LIMB_PAIR(0x4cccca39, 0xffd8a962), LIMB_PAIR(0xfa9ef6e4, 0xe12a8be6),
+      LIMB_PAIR(0x31be868f, 0x85338185), LIMB_PAIR(0xa23a3b36, 0x25878406),
+      LIMB_PARTIAL(0x03c)},
+     {LIMB_PAIR(0x96e54499, 0x14827414), LIMB_PAIR(0x8e050034, 0xa0732f96),
+      LIMB_PAIR(0x467cadc7, 0x1c6fa676), LIMB_PAIR(0x98d6927c, 0xa63ba10c),
+      LIMB_PAIR(0xdcc2500f, 0x58cb6f96), LIMB_PAIR(0xea4fd9c5, 0xaccb76d6),
+      LIMB_PAIR(0x30786990, 0xe2a2f59b), LIMB_PAIR(0xd224ccfe, 0xd8b24679),
+      LIMB_PARTIAL(0x1b2)}},
+    {{LIMB_PAIR(0xa84d476c, 0xdbe7bc43), LIMB_PAIR(0x0df0f82f, 0x80c66135),
+      LIMB_PAIR(0x7996b3dd, 0xfda3915e), LIMB_PAIR(0x5460b6a5, 0xd309856f),
+      LIMB_PAIR(0xfb5f2a03, 0xda60ecfb), LIMB_PAIR(0x87f5c81e, 0xb45421cc),
+      LIMB_PAIR(0x93297e69, 0xe78f50b7), LIMB_PAIR(0x92b7ab1b, 0xb57ef6e0),
+      LIMB_PARTIAL(0x020)},
+     {LIMB_PAIR(0xd5a7e947, 0x2fac246b), LIMB_PAIR(0x3c2c0e9e, 0xa3560f17),
+      LIMB_PAIR(0x99a15edc, 0x36f3bea7), LIMB_PAIR(0xf6df7626, 0x51e0953f),
+      LIMB_PAIR(0xe181410f, 0x791fb8f1), LIMB_PAIR(0x065b1cd7, 0x9e592427),
+      LIMB_PAIR(0x6e9a54b5, 0x492c7736), LIMB_PAIR(0xf664ead5, 0x8f186347),
+      LIMB_PARTIAL(0x1de)}},
+    {{LIMB_PAIR(0xcc9f295b, 0xf8b25de3), LIMB_PAIR(0xd481f758, 0x6a3a6afd),
+      LIMB_PAIR(0xd7194dd7, 0x0f362d65), LIMB_PAIR(0x72839c8b, 0xd0706b14),
+      LIMB_PAIR(0x86e79d73, 0x863fc677), LIMB_PAIR(0xbd51aa66, 0x7a312dd4),
+      LIMB_PAIR(0xe2fb1520, 0x4f54148b), LIMB_PAIR(0xd3fafaa8, 0xf819350e),
+      LIMB_PARTIAL(0x0a5)},
+     {LIMB_PAIR(0xd0ba1319, 0xdade2b22), LIMB_PAIR(0x0e128de4, 0xec0df712),
+      LIMB_PAIR(0xa47d34b8, 0xbfbb4a30), LIMB_PAIR(0x6c0fe4b4, 0x27a996fe),
+      LIMB_PAIR(0xfc390c4c, 0xf37ac376), LIMB_PAIR(0x8f1d9559, 0xa28f1992),
+      LIMB_PAIR(0x7917fb9e, 0x59a81149), LIMB_PAIR(0x24e5bb5e, 0x5658b74f),
+      LIMB_PARTIAL(0x1c1)}},
+    {{LIMB_PAIR(0xe090cb47, 0x0b8c54ed), LIMB_PAIR(0xabacc4b9, 0xddcef543),
+      LIMB_PAIR(0x6f45d144, 0xaa5d9f95), LIMB_PAIR(0x6d5b0b7d, 0x5829ea88),
+      LIMB_PAIR(0x5d9b5a9b, 0xa08415c0), LIMB_PAIR(0x9d469207, 0x0dcdd858),
+      LIMB_PAIR(0xad47d576, 0x91ef5090), LIMB_PAIR(0xfc9c5403, 0x286b59f7),
+      LIMB_PARTIAL(0x0a4)},
+     {LIMB_PAIR(0x681a6033, 0x51f28b4e), LIMB_PAIR(0x5586a02d, 0x92c8812f),
+      LIMB_PAIR(0x37f75be9, 0x65497752), LIMB_PAIR(0xe465ac3d, 0x39ed9c48),
+      LIMB_PAIR(0xea5746a3, 0x52b0558d), LIMB_PAIR(0x2281bf57, 0xb1ad72ea),
+      LIMB_PAIR(0xc29bc5ba, 0xfa48be23), LIMB_PAIR(0xb11e0b1a, 0x5ddd7e6b),
+      LIMB_PARTIAL(0x144)}},
+    {{LIMB_PAIR(0xdfbf1c5d, 0x6b91bd8f), LIMB_PAIR(0x35cbbe74, 0x29cbc8c5),
+      LIMB_PAIR(0xeca1f1e8, 0xf2bf1bf0), LIMB_PAIR(0x8b74129c, 0x64bc1b61),
+      LIMB_PAIR(0xa26db0ba, 0x5701d92d), LIMB_PAIR(0x629c49b0, 0x3bbbda1d),
+      LIMB_PAIR(0x628f9cf9, 0x77932b00), LIMB_PAIR(0xe3b93fd6, 0xf4dd2f98),
+      LIMB_PARTIAL(0x04e)},
+     {LIMB_PAIR(0xe84d1aa9, 0x50d3f239), LIMB_PAIR(0x80be7733, 0x76243d29),
+      LIMB_PAIR(0x5f3a7f3e, 0x8f1f1050), LIMB_PAIR(0xfcef3c41, 0x5b49d4a6),
+      LIMB_PAIR(0x15608cf3, 0x97025d37), LIMB_PAIR(0x0adcffe2, 0x8ce7fbda),
+      LIMB_PAIR(0xf8efc79a, 0xdb4849ec), LIMB_PAIR(0x67855d5b, 0xfe454312),
+      LIMB_PARTIAL(0x087)}},
+    {{LIMB_PAIR(0x643fa4ef, 0xc6d4508a), LIMB_PAIR(0x2f666f82, 0xa54e8cc0),
+      LIMB_PAIR(0x2dc798a4, 0x34a01969), LIMB_PAIR(0x111ebec5, 0x3b92fc56),
+      LIMB_PAIR(0xce2fedd7, 0x8f6bdc34), LIMB_PAIR(0x57cc1dc0, 0x9d5d1b75),
+      LIMB_PAIR(0xb8fef3f8, 0x8019d044), LIMB_PAIR(0xa5f3c3da, 0x8cb35753),
+      LIMB_PARTIAL(0x091)},
+     {LIMB_PAIR(0x1d608111, 0x81975cb9), LIMB_PAIR(0x6d5131e8, 0x423b14c7),
+      LIMB_PAIR(0x9822e028, 0xcd872107), LIMB_PAIR(0x55997e16, 0x3b325e7e),
+      LIMB_PAIR(0x77cb3c94, 0x076a9d7a), LIMB_PAIR(0xa0038852, 0xbc1550aa),
+      LIMB_PAIR(0xf47b925f, 0x4f0e3b8e), LIMB_PAIR(0xdaa979f8, 0xefd3da16),
+      LIMB_PARTIAL(0x117)}},
+    {{LIMB_PAIR(0x8d320182, 0x39d27f3b), LIMB_PAIR(0x57f13ad2, 0xaf725a25),
+      LIMB_PAIR(0x21f64d54, 0x776680a4), LIMB_PAIR(0x346ad04e, 0x8c76f109),
+      LIMB_PAIR(0x02313957, 0x1c57732c), LIMB_PAIR(0x0026d082, 0xd610c412),
+      LIMB_PAIR(0x9f070119, 0xbf2afd03), LIMB_PAIR(0x0fe119e2, 0xb78ab112),
+      LIMB_PARTIAL(0x195)},
+     {LIMB_PAIR(0xde80e59f, 0x6759cf0f), LIMB_PAIR(0x1c569a55, 0xbc9c518d),
+      LIMB_PAIR(0x6ccc33e7, 0x9ef3afb2), LIMB_PAIR(0x3b2b65a2, 0x54cd7e1c),
+      LIMB_PAIR(0x89020840, 0x056d2549), LIMB_PAIR(0xea20691f, 0x2b8c3c49),
+      LIMB_PAIR(0xecf9ed3d, 0xdd6f6cad), LIMB_PAIR(0xcd81c6b2, 0x0287ed9e),
+      LIMB_PARTIAL(0x1aa)}},
+    {{LIMB_PAIR(0x0886fce5, 0x0932a85e), LIMB_PAIR(0x539e0749, 0xf22990fc),
+      LIMB_PAIR(0x9622b480, 0x0900525d), LIMB_PAIR(0x2322a79e, 0xf8159fb8),
+      LIMB_PAIR(0x52225e4a, 0x16bc8fba), LIMB_PAIR(0x3a8b6083, 0x80aed84f),
+      LIMB_PAIR(0x7c8b52d4, 0x0ec2ea9e), LIMB_PAIR(0x8c474025, 0x88586280),
+      LIMB_PARTIAL(0x122)},
+     {LIMB_PAIR(0x1fa537fc, 0x7e82b98a), LIMB_PAIR(0xb07aee91, 0x06814d94),
+      LIMB_PAIR(0x39bbf49e, 0x2ace89a4), LIMB_PAIR(0x572f35de, 0x4272b632),
+      LIMB_PAIR(0xa6132d49, 0x4aa5ec9c), LIMB_PAIR(0x0ac0cc3e, 0x6da8505b),
+      LIMB_PAIR(0xf0b72ace, 0xe50b950f), LIMB_PAIR(0xeb7a6dcb, 0x38d4e07d),
+      LIMB_PARTIAL(0x0bb)}}
+};
+
+// Odd multiples of the generator G for the wNAF multiplication in
+// verify().  Entry i holds the affine point (x, y) for (2 * i + 1) * G.
+static limb_t const P521_wnafG[P521_WNAF_G_SIZE][2][NUM_LIMBS_521BIT] PROGMEM = {
+    {{LIMB_PAIR(0xc2e5bd66, 0xf97e7e31), LIMB_PAIR(0x856a429b, 0x3348b3c1),
+      LIMB_PAIR(0xa2ffa8de, 0xfe1dc127), LIMB_PAIR(0xefe75928, 0xa14b5e77),
+      LIMB_PAIR(0x6b4d3dba, 0xf828af60), LIMB_PAIR(0x053fb521, 0x9c648139),
+      LIMB_PAIR(0x2395b442, 0x9e3ecb66), LIMB_PAIR(0x0404e9cd, 0x858e06b7),
+      LIMB_PARTIAL(0x0c6)},
+     {LIMB_PAIR(0x9fd16650, 0x88be9476), LIMB_PAIR(0xa272c240, 0x353c7086),
+      LIMB_PAIR(0x3fad0761, 0xc550b901), LIMB_PAIR(0x5ef42640, 0x97ee7299),
+      LIMB_PAIR(0x273e662c, 0x17afbd17), LIMB_PAIR(0x579b4468, 0x98f54449),
+      LIMB_PAIR(0x2c7d1bd9, 0x5c8a5fb4), LIMB_PAIR(0x9a3bc004, 0x39296a78),
+      LIMB_PARTIAL(0x118)}},
+    {{LIMB_PAIR(0xde37ad7d, 0xa5919d2e), LIMB_PAIR(0x2c32ea05, 0xaeb49086),
+      LIMB_PAIR(0xb59fe21b, 0x1da6bd16), LIMB_PAIR(0x3a483205, 0xad3f164a),
+      LIMB_PAIR(0x2d7a8dd1, 0xe5ad7a11), LIMB_PAIR(0x123d9ab9, 0xb52a6e5b),
+      LIMB_PAIR(0xb5959479, 0xd91d6a64), LIMB_PAIR(0xde29195d, 0x3d352443),
+      LIMB_PARTIAL(0x1a7)},
+     {LIMB_PAIR(0xee86c0e5, 0x5f588ca1), LIMB_PAIR(0x93a59042, 0xf105c9bc),
+      LIMB_PAIR(0xdec3c70c, 0x2d5aced1), LIMB_PAIR(0x8dc575b0, 0x2e2dd4cf),
+      LIMB_PAIR(0xa355ceec, 0xd2f8ab1f), LIMB_PAIR(0x2a9d0317, 0xf1557fa8),
+      LIMB_PAIR(0xcab814f2, 0x979f86c6), LIMB_PAIR(0xfa62ddd9, 0x9b03b97d),
+      LIMB_PARTIAL(0x13e)}},
+    {{LIMB_PAIR(0xec8f3078, 0xd5ab5096), LIMB_PAIR(0xd8931738, 0x29d7e1e6),
+      LIMB_PAIR(0x137e79a3, 0x7112feaf), LIMB_PAIR(0x5e301423, 0x383c0c6d),
+      LIMB_PAIR(0xf177ace4, 0xcf03dab8), LIMB_PAIR(0xb53f0d24, 0x7a596efd),
+      LIMB_PAIR(0xc04eb0bf, 0x3dbc3391), LIMB_PAIR(0x27a432c7, 0x2bf3c529),
+      LIMB_PARTIAL(0x065)},
+     {LIMB_PAIR(0xdeb090cb, 0x173cc3e8), LIMB_PAIR(0x7354f7f8, 0xd1f00725),
+      LIMB_PAIR(0x1cf5ff79, 0x31154021), LIMB_PAIR(0x072cf374, 0xbb6897c9),
+      LIMB_PAIR(0xa0347087, 0xedd817c9), LIMB_PAIR(0x872e0051, 0x1cd8fe8e),
+      LIMB_PAIR(0x4a811291, 0x8a2b7311), LIMB_PAIR(0x6601d6ec, 0xe6ef1bdd),
+      LIMB_PARTIAL(0x15b)}},
+    {{LIMB_PAIR(0x2816ecd4, 0x01cead88), LIMB_PAIR(0xfdc2619a, 0x6f953f50),
+      LIMB_PAIR(0xdce3bbc4, 0xc9a6df30), LIMB_PAIR(0xbfc698d8, 0x8c308d0a),
+      LIMB_PAIR(0xf7114c5d, 0xf018d2c2), LIMB_PAIR(0xf5483228, 0x5f22e0e8),
+      LIMB_PAIR(0x0b073a0c, 0xeeb65fda), LIMB_PAIR(0x5b7f6346, 0xd5d1d99d),
+      LIMB_PARTIAL(0x056)},
+     {LIMB_PAIR(0x0525251b, 0x5c6b8bc9), LIMB_PAIR(0x5ddefc7b, 0x9e76712a),
+      LIMB_PAIR(0x91ce1a5f, 0x9523a345), LIMB_PAIR(0xcdec9e2b, 0x6bd0f293),
+      LIMB_PAIR(0x26cbde55, 0x71dbd98a), LIMB_PAIR(0x2824f0dd, 0xb5c582d0),
+      LIMB_PAIR(0x39d68478, 0xd1d8317a), LIMB_PAIR(0xaaa2a110, 0x2d1b7d9b),
+      LIMB_PARTIAL(0x03d)}},
+    {{LIMB_PAIR(0x67cbe207, 0x1f456279), LIMB_PAIR(0x85cd2866, 0x4f50babd),
+      LIMB_PAIR(0x725a318f, 0xf3c556df), LIMB_PAIR(0x6134da35, 0x7429e139),
+      LIMB_PAIR(0xb8c6b665, 0x2c4ab145), LIMB_PAIR(0x98874699, 0xed34541b),
+      LIMB_PAIR(0x7156d488, 0xa2f5bf15), LIMB_PAIR(0xe1e21826, 0x5389e359),
+      LIMB_PARTIAL(0x158)},
+     {LIMB_PAIR(0xb9ad2a4e, 0x3aa0ea86), LIMB_PAIR(0x28880f34, 0x736c2ae9),
+      LIMB_PAIR(0x4abfd87d, 0x0ff56ecf), LIMB_PAIR(0x6057ac84, 0x0d69e575),
+      LIMB_PAIR(0x3ddb446e, 0xc825ba26), LIMB_PAIR(0xee1cebb6, 0x3088a654),
+      LIMB_PAIR(0x27ae938e, 0x0b55557a), LIMB_PAIR(0x8aedf39f, 0x2e618c9a),
+      LIMB_PARTIAL(0x02a)}},
+    {{LIMB_PAIR(0xda0cdb9a, 0xecc0e02d), LIMB_PAIR(0xa4c9a902, 0x015c024f),
+      LIMB_PAIR(0xe3191085, 0xd19b1aeb), LIMB_PAIR(0x2663da1b, 0xf3dbc533),
+      LIMB_PAIR(0xf2991652, 0x43ef2c54), LIMB_PAIR(0x7c178495, 0xed5dc7ed),
+      LIMB_PAIR(0x3b4315cf, 0x6f1a3957), LIMB_PAIR(0xfdedff54, 0x75841259),
+      LIMB_PARTIAL(0x08a)},
+     {LIMB_PAIR(0xce48c808, 0x58874f92), LIMB_PAIR(0xf4819b5d, 0xdcac80e3),
+      LIMB_PAIR(0x14a95336, 0x38923319), LIMB_PAIR(0x8b42a4ab, 0x1bc8a90e),
+      LIMB_PAIR(0xe0b9b82b, 0xed2e95d4), LIMB_PAIR(0x10bd0493, 0x3add5662),
+      LIMB_PAIR(0x054fb229, 0x9d0ca877), LIMB_PAIR(0xba212984, 0xfb303fcb),
+      LIMB_PARTIAL(0x096)}},
+    {{LIMB_PAIR(0x32fbcda7, 0x1887848d), LIMB_PAIR(0xab38eff8, 0x4bec3b00),
+      LIMB_PAIR(0x9ab88ee9, 0x3550a5e7), LIMB_PAIR(0xe03c996a, 0x32c45908),
+      LIMB_PAIR(0xaf5b8661, 0x4eedd2be), LIMB_PAIR(0xe1b4c238, 0x93f736cd),
+      LIMB_PAIR(0x4924861a, 0xd7865d2b), LIMB_PAIR(0xc396ad9c, 0x3e98f984),
+      LIMB_PARTIAL(0x07e)},
+     {LIMB_PAIR(0x022a71c9, 0x291a01fb), LIMB_PAIR(0x9117e9f7, 0x6199eaaf),
+      LIMB_PAIR(0x1cbfbbc3, 0x26dfdd35), LIMB_PAIR(0x38bc763f, 0xc1bd5d58),
+      LIMB_PAIR(0x5c1e212a, 0x9c7a67ae), LIMB_PAIR(0x6d5421c6, 0xced50a38),
+      LIMB_PAIR(0xa3ed5a08, 0x1a1926da), LIMB_PAIR(0x781feda9, 0xee58eb6d),
+      LIMB_PARTIAL(0x108)}},
+    {{LIMB_PAIR(0xbcb8db55, 0xe9afe337), LIMB_PAIR(0x1e3f92bd, 0x9b8d9698),
+      LIMB_PAIR(0x8fc0331d, 0x7875bd1c), LIMB_PAIR(0xdbd00ffe, 0xb91cce27),
+      LIMB_PAIR(0xdf128e11, 0xd697b532), LIMB_PAIR(0xb40a0852, 0xb8fbcc30),
+      LIMB_PAIR(0x46d4300f, 0x41558fc5), LIMB_PAIR(0xb92465f0, 0x6ad89abc),
+      LIMB_PARTIAL(0x06b)},
+     {LIMB_PAIR(0xa1475465, 0x56343480), LIMB_PAIR(0x446abdd9, 0x46fd90cc),
+      LIMB_PAIR(0x2c96c992, 0x2148e223), LIMB_PAIR(0x99470a80, 0x7e9062c8),
+      LIMB_PAIR(0x97485ed5, 0x4b621069), LIMB_PAIR(0xbad20cba, 0xdf0496a9),
+      LIMB_PAIR(0x33edbf63, 0x7ce64d23), LIMB_PAIR(0x71391d6a, 0x68da2715),
+      LIMB_PARTIAL(0x1b4)}}
+};
+
 /** @endcond */
 
 /**
@@ -310,9 +748,7 @@ void P521::sign(uint8_t signature[132], const uint8_t privateKey[66],
             generateK(k, hm, privateKey, count);
 
         // Generate r = kG.x mod q.
-        memcpy_P(x, P521_Gx, sizeof(x));
-        memcpy_P(y, P521_Gy, sizeof(y));
-        evaluate(x, y, k);
+        evaluateGenerator(x, y, k);
         BigNumberUtil::reduceQuick_P(x, x, P521_q, NUM_LIMBS_521BIT);
         BigNumberUtil::packBE(signature, 66, x, NUM_LIMBS_521BIT);
 
@@ -426,17 +862,15 @@ bool P521::verify(const uint8_t signature[132],
     mulQ(u1, u1, u2);
     mulQ(u2, r, u2);
 
-    // Compute the curve point R = u2 * publicKey + u1 * G.
-    BigNumberUtil::packBE(t, 66, u2, NUM_LIMBS_521BIT);
-    evaluate(x, y, t);
-    memcpy_P(u2, P521_Gx, sizeof(x));
-    memcpy_P(s, P521_Gy, sizeof(y));
+    // Compute the curve point R = u1 * G + u2 * publicKey.  The signature
+    // is invalid if R is the point at infinity.
     BigNumberUtil::packBE(t, 66, u1, NUM_LIMBS_521BIT);
-    evaluate(u2, s, t);
-    addAffine(u2, s, x, y);
+    BigNumberUtil::packBE((uint8_t *)s, 66, u2, NUM_LIMBS_521BIT);
+    if (!evaluateJoint(x, y, t, (const uint8_t *)s))
+        goto failed;
 
     // If R.x = r mod q, then the signature is valid.
-    BigNumberUtil::reduceQuick_P(u1, u2, P521_q, NUM_LIMBS_521BIT);
+    BigNumberUtil::reduceQuick_P(u1, x, P521_q, NUM_LIMBS_521BIT);
     ok = secure_compare(u1, r, NUM_LIMBS_521BIT * sizeof(limb_t));
 
     // Clean up and exit.
@@ -499,9 +933,7 @@ void P521::derivePublicKey(uint8_t publicKey[132], const uint8_t privateKey[66])
     // Evaluate the curve function starting with the generator.
     limb_t x[NUM_LIMBS_521BIT];
     limb_t y[NUM_LIMBS_521BIT];
-    memcpy_P(x, P521_Gx, sizeof(x));
-    memcpy_P(y, P521_Gy, sizeof(y));
-    evaluate(x, y, privateKey);
+    evaluateGenerator(x, y, privateKey);
 
     // Pack the (x, y) point into the public key.
     BigNumberUtil::packBE(publicKey, 66, x, NUM_LIMBS_521BIT);
@@ -584,6 +1016,17 @@ bool P521::isValidPublicKey(const uint8_t publicKey[132])
  * two operations are equivalent.
  */
 
+// Extracts the window of bits starting at bit "posn" from a 521-bit
+// big-endian scalar.  The position is public so the branch is safe.
+static inline uint8_t scalarWindow(const uint8_t f[66], uint16_t posn)
+{
+    uint8_t index = 65 - (posn / 8);
+    uint16_t bits = f[index];
+    if (index > 0)
+        bits |= ((uint16_t)(f[index - 1])) << 8;
+    return (uint8_t)((bits >> (posn % 8)) & (P521_WINDOW_SIZE - 1));
+}
+
 /**
  * \brief Evaluates the curve function by multiplying (x, y) by f.
  *
@@ -593,57 +1036,263 @@ bool P521::isValidPublicKey(const uint8_t publicKey[132])
  * co-ordinate of the result on exit.
  * \param f The 521-bit scalar to multiply (x, y) by, most significant
  * bit first.
+ *
+ * The scalar is processed P521_WINDOW_BITS bits at a time using a table
+ * of the small multiples 1 * (x, y) to (P521_WINDOW_SIZE - 1) * (x, y).
+ * Every window performs the same doublings, a full scan of the table,
+ * and a single point addition so that the timing does not depend on f.
+ *
+ * Only the low 521 bits of f are used, and they are reduced modulo q
+ * before the windows are processed.
  */
 void P521::evaluate(limb_t *x, limb_t *y, const uint8_t f[66])
 {
+    limb_t table[P521_WINDOW_SIZE - 1][3][NUM_LIMBS_521BIT];
     limb_t x1[NUM_LIMBS_521BIT];
     limb_t y1[NUM_LIMBS_521BIT];
     limb_t z1[NUM_LIMBS_521BIT];
     limb_t x2[NUM_LIMBS_521BIT];
     limb_t y2[NUM_LIMBS_521BIT];
     limb_t z2[NUM_LIMBS_521BIT];
+    limb_t fq[NUM_LIMBS_1042BIT];
+    uint8_t g[66];
+    uint8_t index;
+
+    // Reduce the low 521 bits of f modulo q.  This doesn't change the
+    // answer because every point on the curve has order q, but it
+    // guarantees that the running total never equals the multiple that
+    // is added to it.  That in turn means that addPoint() never has to
+    // handle the doubling case.
+    memcpy(g, f, sizeof(g));
+    g[0] &= 0x01;
+    BigNumberUtil::unpackBE(fq, NUM_LIMBS_1042BIT, g, 66);
+    reduceQ(fq, fq);
+    BigNumberUtil::packBE(g, 66, fq, NUM_LIMBS_521BIT);
 
     // We want the input in Jacobian co-ordinates.  The point (x, y, z)
     // corresponds to the affine point (x / z^2, y / z^3), so if we set z
-    // to 1 we end up with Jacobian co-ordinates.  Remember that z is 1
-    // and continue on.
+    // to 1 we end up with Jacobian co-ordinates.  Then fill the table
+    // with the multiples, where table[i] holds (i + 1) * (x, y, 1).
+    // Even multiples are created by doubling so that addPoint() is never
+    // asked to add a point to itself.
+    memcpy(table[0][0], x, sizeof(x1));
+    memcpy(table[0][1], y, sizeof(y1));
+    memset(table[0][2], 0, sizeof(z1));
+    table[0][2][0] = 1;
+    for (index = 1; index < (P521_WINDOW_SIZE - 1); ++index) {
+        if (index & 1) {
+            dblPoint(table[index][0], table[index][1], table[index][2],
+                     table[index / 2][0], table[index / 2][1],
+                     table[index / 2][2]);
+        } else {
+            addPoint(table[index][0], table[index][1], table[index][2],
+                     table[index - 1][0], table[index - 1][1],
+                     table[index - 1][2], x, y/*, z*/);
+        }
+    }
+
+    // Convert the table into affine co-ordinates with a single inversion
+    // so that the main loop can use the cheaper mixed point addition.
+    normalizePoints(table[0][0], P521_WINDOW_SIZE - 1);
 
     // Set the answer to the point-at-infinity initially (z = 0).
     memset(x1, 0, sizeof(x1));
     memset(y1, 0, sizeof(y1));
     memset(z1, 0, sizeof(z1));
 
-    // Special handling for the highest bit.  We can skip dblPoint()/addPoint()
-    // and simply conditionally move (x, y, z) into (x1, y1, z1).
-    uint8_t select = (f[0] & 0x01);
-    cmove(select, x1, x);
-    cmove(select, y1, y);
-    cmove1(select, z1); // z = 1
-
-    // Iterate over the remaining 520 bits of f from highest to lowest.
-    uint8_t mask = 0x80;
-    uint8_t fposn = 1;
-    for (uint16_t t = 520; t > 0; --t) {
+    // Iterate over the windows of f from highest to lowest.
+    uint16_t posn = P521_NUM_WINDOWS * P521_WINDOW_BITS;
+    while (posn > 0) {
+        posn -= P521_WINDOW_BITS;
+
+        // Shift the answer up by the number of bits in a window.
+        for (index = 0; index < P521_WINDOW_BITS; ++index)
+            dblPoint(x1, y1, z1, x1, y1, z1);
+
+        // Look up the multiple for this window.  We scan the entire
+        // table to avoid leaking the window value via the cache.
+        uint8_t digit = scalarWindow(g, posn);
+        memcpy(x, table[0][0], sizeof(x1));
+        memcpy(y, table[0][1], sizeof(y1));
+        for (index = 1; index < (P521_WINDOW_SIZE - 1); ++index) {
+            // select is non-zero if digit == index + 1.
+            limb_t select = (limb_t)
+                (((uint16_t)(digit ^ (index + 1)) - 1) >> 8);
+            cmove(select, x, table[index][0]);
+            cmove(select, y, table[index][1]);
+        }
+
+        // Add the multiple to the answer.  We must always do this to
+        // preserve the overall timing, and then keep the previous answer
+        // if the window was zero.
+        addPoint(x2, y2, z2, x1, y1, z1, x, y/*, z*/);
+        cmove(digit, x1, x2);
+        cmove(digit, y1, y2);
+        cmove(digit, z1, z2);
+    }
+
+    // Convert from Jacobian co-ordinates back into affine co-ordinates.
+    // x = x1 * (z1^2)^-1, y = y1 * (z1^3)^-1.
+    recip(x2, z1);
+    square(y2, x2);
+    mul(x, x1, y2);
+    mul(y2, y2, x2);
+    mul(y, y1, y2);
+
+    // Clean up.
+    clean(table);
+    clean(x1);
+    clean(y1);
+    clean(z1);
+    clean(x2);
+    clean(y2);
+    clean(z2);
+    clean(fq);
+    clean(g);
+}
+
+/**
+ * \brief Converts a table of points from Jacobian into affine co-ordinates.
+ *
+ * \param points The points to convert, consisting of \a count entries of
+ * X, Y, and Z values of NUM_LIMBS_521BIT limbs each.  On exit, the X and Y
+ * values are replaced with the affine co-ordinates and Z is set to 1.
+ * \param count The number of points, which must be between 1 and
+ * P521_WINDOW_SIZE - 1.
+ *
+ * This uses Montgomery's trick to perform a single field inversion for
+ * the entire table plus three multiplications per point, instead of one
+ * inversion per point.  None of the points may be the point-at-infinity.
+ */
+void P521::normalizePoints(limb_t *points, uint8_t count)
+{
+    limb_t prefix[P521_WINDOW_SIZE - 1][NUM_LIMBS_521BIT];
+    limb_t inv[NUM_LIMBS_521BIT];
+    limb_t zinv[NUM_LIMBS_521BIT];
+    limb_t t[NUM_LIMBS_521BIT];
+    limb_t *point;
+    uint8_t index;
+
+    // Compute the running products of the z values, where prefix[i]
+    // holds z[0] * z[1] * ... * z[i].
+    memcpy(prefix[0], points + 2 * NUM_LIMBS_521BIT, sizeof(t));
+    for (index = 1; index < count; ++index) {
+        point = points + index * 3 * NUM_LIMBS_521BIT;
+        mul(prefix[index], prefix[index - 1], point + 2 * NUM_LIMBS_521BIT);
+    }
+
+    // Invert the product of all z values and then peel off the
+    // inverse of each z value, working backwards through the table.
+    recip(inv, prefix[count - 1]);
+    index = count;
+    while (index > 0) {
+        --index;
+        point = points + index * 3 * NUM_LIMBS_521BIT;
+        if (index > 0) {
+            mul(zinv, inv, prefix[index - 1]);
+            mul(inv, inv, point + 2 * NUM_LIMBS_521BIT);
+        } else {
+            memcpy(zinv, inv, sizeof(zinv));
+        }
+
+        // x = x * zinv^2, y = y * zinv^3, z = 1.
+        square(t, zinv);
+        mul(point, point, t);
+        mul(t, t, zinv);
+        mul(point + NUM_LIMBS_521BIT, point + NUM_LIMBS_521BIT, t);
+        memset(point + 2 * NUM_LIMBS_521BIT, 0, sizeof(t));
+        point[2 * NUM_LIMBS_521BIT] = 1;
+    }
+
+    // Clean up.
+    clean(prefix);
+    clean(inv);
+    clean(zinv);
+    clean(t);
+}
+
+/**
+ * \brief Evaluates the curve function by multiplying the generator G by f.
+ *
+ * \param x The X co-ordinate of the result on exit.
+ * \param y The Y co-ordinate of the result on exit.
+ * \param f The 521-bit scalar to multiply G by, most significant bit
+ * first.
+ *
+ * This is a faster alternative to evaluate() when the point is G.  It uses
+ * a comb method with the precomputed table P521_comb, which needs 105
+ * doublings and 105 mixed additions instead of 524 doublings and 131
+ * general additions.  Each step scans the whole table so the timing and
+ * memory access pattern do not depend on f.
+ *
+ * Only the low 521 bits of f are used, and they are reduced modulo q
+ * before the comb is applied, so the result is the same as evaluate().
+ *
+ * \sa evaluate()
+ */
+void P521::evaluateGenerator(limb_t *x, limb_t *y, const uint8_t f[66])
+{
+    limb_t x1[NUM_LIMBS_521BIT];
+    limb_t y1[NUM_LIMBS_521BIT];
+    limb_t z1[NUM_LIMBS_521BIT];
+    limb_t x2[NUM_LIMBS_521BIT];
+    limb_t y2[NUM_LIMBS_521BIT];
+    limb_t z2[NUM_LIMBS_521BIT];
+    limb_t fq[NUM_LIMBS_1042BIT];
+    uint8_t g[66];
+    uint8_t index;
+
+    // Reduce the low 521 bits of f modulo q, as in evaluate().
+    memcpy(g, f, sizeof(g));
+    g[0] &= 0x01;
+    BigNumberUtil::unpackBE(fq, NUM_LIMBS_1042BIT, g, 66);
+    reduceQ(fq, fq);
+    BigNumberUtil::packBE(g, 66, fq, NUM_LIMBS_521BIT);
+
+    // Set the answer to the point-at-infinity initially (z = 0).
+    memset(x1, 0, sizeof(x1));
+    memset(y1, 0, sizeof(y1));
+    memset(z1, 0, sizeof(z1));
+
+    // Process one bit from each of the comb's teeth at a time.
+    uint8_t column = P521_COMB_SPACING;
+    while (column > 0) {
+        --column;
+
         // Double the answer.
         dblPoint(x1, y1, z1, x1, y1, z1);
 
-        // Add (x, y, z) to (x1, y1, z1) for the next 1 bit.
-        // We must always do this to preserve the overall timing.
-        // The z value is always 1 so we can omit that argument.
-        addPoint(x2, y2, z2, x1, y1, z1, x, y/*, z*/);
+        // Collect the bits for this column into a table index.
+        uint8_t digit = 0;
+        for (index = 0; index < P521_COMB_TEETH; ++index) {
+            uint16_t bit = column + index * P521_COMB_SPACING;
+            digit |= ((g[65 - (bit / 8)] >> (bit % 8)) & 0x01) << index;
+        }
 
-        // If the bit was 1, then move (x2, y2, z2) into (x1, y1, z1).
-        select = (f[fposn] & mask);
-        cmove(select, x1, x2);
-        cmove(select, y1, y2);
-        cmove(select, z1, z2);
-
-        // Move onto the next bit.
-        mask >>= 1;
-        if (!mask) {
-            ++fposn;
-            mask = 0x80;
+        // Look up the table entry, scanning the entire table to avoid
+        // leaking the index via the cache.
+        for (index = 0; index < P521_COMB_SIZE; ++index) {
+            // select is non-zero if digit == index + 1.
+            limb_t select = (limb_t)
+                (((uint16_t)(digit ^ (index + 1)) - 1) >> 8);
+            memcpy_P(z2, P521_comb[index][0], sizeof(z2));
+            if (index == 0)
+                memcpy(x2, z2, sizeof(x2));
+            else
+                cmove(select, x2, z2);
+            memcpy_P(z2, P521_comb[index][1], sizeof(z2));
+            if (index == 0)
+                memcpy(y2, z2, sizeof(y2));
+            else
+                cmove(select, y2, z2);
         }
+
+        // Add the entry to the answer, and then keep the previous
+        // answer if all of the bits in the column were zero.
+        addPoint(x, y, z2, x1, y1, z1, x2, y2/*, z*/);
+        cmove(digit, x1, x);
+        cmove(digit, y1, y);
+        cmove(digit, z1, z2);
     }
 
     // Convert from Jacobian co-ordinates back into affine co-ordinates.
@@ -661,45 +1310,170 @@ void P521::evaluate(limb_t *x, limb_t *y, const uint8_t f[66])
     clean(x2);
     clean(y2);
     clean(z2);
+    clean(fq);
+    clean(g);
+}
+
+// Recodes a 521-bit big-endian scalar into width-w non-adjacent form.
+// Every non-zero digit in "naf" is odd and lies between -(2^(w-1) - 1)
+// and 2^(w-1) - 1, and each non-zero digit is followed by at least w - 1
+// zero digits.  This runs in variable time so it must only be used on
+// public scalars.
+static void scalarToWNAF(int8_t *naf, const uint8_t f[66], uint8_t w)
+{
+    uint16_t posn = 0;
+    uint8_t carry = 0;
+    memset(naf, 0, P521_WNAF_DIGITS);
+    while (posn < P521_WNAF_DIGITS) {
+        // Skip over bits that are equal to the carry as they produce
+        // a zero digit once the carry is added in.
+        uint8_t bit = 0;
+        if (posn < 528)
+            bit = (f[65 - (posn / 8)] >> (posn % 8)) & 0x01;
+        if (bit == carry) {
+            ++posn;
+            continue;
+        }
+
+        // Extract the next w bits and add the carry.
+        uint8_t len = w;
+        if (len > (P521_WNAF_DIGITS - posn))
+            len = P521_WNAF_DIGITS - posn;
+        int16_t word = carry;
+        for (uint8_t index = 0; index < len; ++index) {
+            uint16_t b = posn + index;
+            if (b < 528)
+                word += ((f[65 - (b / 8)] >> (b % 8)) & 0x01) << index;
+        }
+
+        // Make the digit negative if its top bit is set and carry the
+        // difference into the next window.
+        carry = (word >> (w - 1)) & 0x01;
+        naf[posn] = (int8_t)(word - (carry << w));
+        posn += len;
+    }
 }
 
 /**
- * \brief Adds two affine points.
+ * \brief Evaluates f1 * G + f2 * (x, y) in variable time.
  *
- * \param x1 The X value for the first point to add, and the result.
- * \param y1 The Y value for the first point to add, and the result.
- * \param x2 The X value for the second point to add.
- * \param y2 The Y value for the second point to add.
+ * \param x The X co-ordinate of the curve point.  Replaced with the X
+ * co-ordinate of the result on exit.
+ * \param y The Y co-ordinate of the curve point.  Replaced with the Y
+ * co-ordinate of the result on exit.
+ * \param f1 The 521-bit scalar to multiply the generator G by, most
+ * significant bit first.
+ * \param f2 The 521-bit scalar to multiply (x, y) by, most significant
+ * bit first.
+ *
+ * \return Returns false if the result is the point at infinity, which
+ * cannot be represented in affine co-ordinates.
+ *
+ * Both scalars are recoded into wNAF form and processed together so that
+ * the two multiplications share a single chain of doublings.  The odd
+ * multiples of G come from P521_wnafG and the odd multiples of (x, y) are
+ * computed at the start.  The result is only converted back into affine
+ * co-ordinates once at the end.
  *
- * The Z values for the two points are assumed to be 1.
+ * The timing of this function depends upon the scalars and the point,
+ * so it must only be used on public values such as in verify().
+ *
+ * \sa evaluate(), evaluateGenerator()
  */
-void P521::addAffine(limb_t *x1, limb_t *y1, const limb_t *x2, const limb_t *y2)
+bool P521::evaluateJoint(limb_t *x, limb_t *y, const uint8_t f1[66],
+                         const uint8_t f2[66])
 {
-    limb_t xout[NUM_LIMBS_521BIT];
-    limb_t yout[NUM_LIMBS_521BIT];
-    limb_t zout[NUM_LIMBS_521BIT];
+    limb_t table[P521_WNAF_Q_SIZE][3][NUM_LIMBS_521BIT];
+    limb_t x1[NUM_LIMBS_521BIT];
+    limb_t y1[NUM_LIMBS_521BIT];
     limb_t z1[NUM_LIMBS_521BIT];
+    limb_t x2[NUM_LIMBS_521BIT];
+    limb_t y2[NUM_LIMBS_521BIT];
+    limb_t z2[NUM_LIMBS_521BIT];
+    int8_t naf1[P521_WNAF_DIGITS];
+    int8_t naf2[P521_WNAF_DIGITS];
+    int16_t posn;
+    uint8_t index;
+    int8_t digit;
+    bool ok = false;
+
+    // Recode the scalars.
+    scalarToWNAF(naf1, f1, P521_WNAF_G_BITS);
+    scalarToWNAF(naf2, f2, P521_WNAF_Q_BITS);
+
+    // Fill the table with the odd multiples of (x, y, 1), where table[i]
+    // holds (2 * i + 1) * (x, y, 1).  The double of (x, y) is in (x2, y2, z2).
+    memcpy(table[0][0], x, sizeof(x1));
+    memcpy(table[0][1], y, sizeof(y1));
+    memset(table[0][2], 0, sizeof(z1));
+    table[0][2][0] = 1;
+    dblPoint(x2, y2, z2, table[0][0], table[0][1], table[0][2]);
+    for (index = 1; index < P521_WNAF_Q_SIZE; ++index) {
+        memcpy(table[index], table[index - 1], sizeof(table[0]));
+        addPointVarTime(table[index][0], table[index][1], table[index][2],
+                        x2, y2, z2);
+    }
 
-    // z1 = 1
-    z1[0] = 1;
-    memset(z1 + 1, 0, (NUM_LIMBS_521BIT - 1) * sizeof(limb_t));
+    // Set the answer to the point-at-infinity initially (z = 0).
+    memset(x1, 0, sizeof(x1));
+    memset(y1, 0, sizeof(y1));
+    memset(z1, 0, sizeof(z1));
 
-    // Add the two points.
-    addPoint(xout, yout, zout, x1, y1, z1, x2, y2/*, z2*/);
+    // Skip the leading zero digits and then process the rest from
+    // highest to lowest.  Negative digits are handled by negating y.
+    posn = P521_WNAF_DIGITS - 1;
+    while (posn >= 0 && !naf1[posn] && !naf2[posn])
+        --posn;
+    for (; posn >= 0; --posn) {
+        dblPoint(x1, y1, z1, x1, y1, z1);
+        digit = naf1[posn];
+        if (digit) {
+            index = (digit > 0 ? digit : -digit) / 2;
+            memcpy_P(x2, P521_wnafG[index][0], sizeof(x2));
+            memcpy_P(y2, P521_wnafG[index][1], sizeof(y2));
+            if (digit < 0) {
+                memset(z2, 0, sizeof(z2));
+                sub(y2, z2, y2);
+            }
+            addPointVarTime(x1, y1, z1, x2, y2, 0);
+        }
+        digit = naf2[posn];
+        if (digit) {
+            index = (digit > 0 ? digit : -digit) / 2;
+            if (digit < 0) {
+                memset(z2, 0, sizeof(z2));
+                sub(y2, z2, table[index][1]);
+                addPointVarTime(x1, y1, z1, table[index][0], y2,
+                                table[index][2]);
+            } else {
+                addPointVarTime(x1, y1, z1, table[index][0],
+                                table[index][1], table[index][2]);
+            }
+        }
+    }
 
     // Convert from Jacobian co-ordinates back into affine co-ordinates.
-    // x1 = xout * (zout^2)^-1, y1 = yout * (zout^3)^-1.
-    recip(z1, zout);
-    square(zout, z1);
-    mul(x1, xout, zout);
-    mul(zout, zout, z1);
-    mul(y1, yout, zout);
+    // x = x1 * (z1^2)^-1, y = y1 * (z1^3)^-1.
+    if (!BigNumberUtil::isZero(z1, NUM_LIMBS_521BIT)) {
+        recip(x2, z1);
+        square(y2, x2);
+        mul(x, x1, y2);
+        mul(y2, y2, x2);
+        mul(y, y1, y2);
+        ok = true;
+    }
 
     // Clean up.
-    clean(xout);
-    clean(yout);
-    clean(zout);
+    clean(table);
+    clean(x1);
+    clean(y1);
     clean(z1);
+    clean(x2);
+    clean(y2);
+    clean(z2);
+    clean(naf1);
+    clean(naf2);
+    return ok;
 }
 
 /**
@@ -949,6 +1723,204 @@ void P521::mulNoReduce(limb_t *result, const limb_t *x, const limb_t *y)
     }
 }
 
+#if BIGNUMBER_LIMB_64BIT
+
+// On 64-bit platforms, mul() switches to nine unsaturated 58-bit limbs
+// internally.  The column sums can then be accumulated in 128-bit words
+// without propagating carries after every product, and the high half of
+// the product can be folded into the low half using 2^522 = 2 mod p.
+#define P521_LIMB58_MASK    ((((uint64_t)1) << 58) - 1)
+
+// Splits a saturated 521-bit value into nine 58-bit limbs.
+static inline void unpack58(uint64_t *out, const limb_t *x)
+{
+    out[0] =   x[0]                      & P521_LIMB58_MASK;
+    out[1] = ((x[0] >> 58) | (x[1] <<  6)) & P521_LIMB58_MASK;
+    out[2] = ((x[1] >> 52) | (x[2] << 12)) & P521_LIMB58_MASK;
+    out[3] = ((x[2] >> 46) | (x[3] << 18)) & P521_LIMB58_MASK;
+    out[4] = ((x[3] >> 40) | (x[4] << 24)) & P521_LIMB58_MASK;
+    out[5] = ((x[4] >> 34) | (x[5] << 30)) & P521_LIMB58_MASK;
+    out[6] = ((x[5] >> 28) | (x[6] << 36)) & P521_LIMB58_MASK;
+    out[7] = ((x[6] >> 22) | (x[7] << 42)) & P521_LIMB58_MASK;
+    out[8] =  (x[7] >> 16) | (x[8] << 48);
+}
+
+// Multiplies two 58-bit limbs to produce a 116-bit product.
+#define P521_MUL(x, y)      (((unsigned __int128)(x)) * (y))
+
+// Reduces nine 128-bit column sums modulo 2^521 - 1 and packs the
+// canonical result back into saturated limbs.
+static void reduce58(limb_t *result, unsigned __int128 *t)
+{
+    unsigned __int128 carry;
+    uint64_t r[9];
+    uint8_t i;
+
+    // Propagate the carries, folding the carry out of the top limb
+    // and bit 521 back into the bottom limb.
+    carry = 0;
+    for (i = 0; i < 9; ++i) {
+        carry += t[i];
+        r[i] = ((uint64_t)carry) & P521_LIMB58_MASK;
+        carry >>= 58;
+    }
+    carry = (carry << 1) + (r[8] >> 57);
+    r[8] &= P521_LIMB58_MASK >> 1;
+
+    // Pack the 58-bit limbs back into saturated form while adding the
+    // folded carry plus 1.  Adding 1 and then subtracting 2^521 is the
+    // same as a trial subtraction of 2^521 - 1.
+    carry += 1;
+    carry +=  r[0]        | (r[1] << 58);
+    result[0] = (limb_t)carry;
+    carry >>= 64;
+    carry += (r[1] >>  6) | (r[2] << 52);
+    result[1] = (limb_t)carry;
+    carry >>= 64;
+    carry += (r[2] >> 12) | (r[3] << 46);
+    result[2] = (limb_t)carry;
+    carry >>= 64;
+    carry += (r[3] >> 18) | (r[4] << 40);
+    result[3] = (limb_t)carry;
+    carry >>= 64;
+    carry += (r[4] >> 24) | (r[5] << 34);
+    result[4] = (limb_t)carry;
+    carry >>= 64;
+    carry += (r[5] >> 30) | (r[6] << 28);
+    result[5] = (limb_t)carry;
+    carry >>= 64;
+    carry += (r[6] >> 36) | (r[7] << 22);
+    result[6] = (limb_t)carry;
+    carry >>= 64;
+    carry += (r[7] >> 42) | (r[8] << 16);
+    result[7] = (limb_t)carry;
+    carry >>= 64;
+    carry +=  r[8] >> 48;
+    result[8] = (limb_t)carry;
+
+    // If bit 521 is now set, then mask it off and we have the answer.
+    // Otherwise we need to subtract the 1 again.
+    carry = ((result[8] >> 9) ^ 0x01) & 0x01;
+    for (i = 0; i < 9; ++i) {
+        carry = ((unsigned __int128)(result[i])) - carry;
+        result[i] = (limb_t)carry;
+        carry = (carry >> 64) & 0x01;
+    }
+    result[8] &= 0x1FF;
+
+    // Clean up.
+    strict_clean(r);
+}
+
+// Multiplies two values in 58-bit limb form and reduces the result.
+// Products at limb position 9 and above are worth 2^522 = 2 times as
+// much as the same position 9 limbs lower, so they are folded down
+// using b2 = 2 * b.  Each column is the sum of nine products of less
+// than 2^117, which easily fits in 128 bits.
+static void mul58(limb_t *result, const uint64_t *a, const uint64_t *b)
+{
+    unsigned __int128 t[9];
+    uint64_t b2[9];
+    uint8_t i;
+    for (i = 0; i < 9; ++i)
+        b2[i] = b[i] << 1;
+    t[0] = P521_MUL(a[0], b[0]) + P521_MUL(a[1], b2[8]) +
+           P521_MUL(a[2], b2[7]) + P521_MUL(a[3], b2[6]) +
+           P521_MUL(a[4], b2[5]) + P521_MUL(a[5], b2[4]) +
+           P521_MUL(a[6], b2[3]) + P521_MUL(a[7], b2[2]) +
+           P521_MUL(a[8], b2[1]);
+    t[1] = P521_MUL(a[0], b[1]) + P521_MUL(a[1], b[0]) +
+           P521_MUL(a[2], b2[8]) + P521_MUL(a[3], b2[7]) +
+           P521_MUL(a[4], b2[6]) + P521_MUL(a[5], b2[5]) +
+           P521_MUL(a[6], b2[4]) + P521_MUL(a[7], b2[3]) +
+           P521_MUL(a[8], b2[2]);
+    t[2] = P521_MUL(a[0], b[2]) + P521_MUL(a[1], b[1]) +
+           P521_MUL(a[2], b[0]) + P521_MUL(a[3], b2[8]) +
+           P521_MUL(a[4], b2[7]) + P521_MUL(a[5], b2[6]) +
+           P521_MUL(a[6], b2[5]) + P521_MUL(a[7], b2[4]) +
+           P521_MUL(a[8], b2[3]);
+    t[3] = P521_MUL(a[0], b[3]) + P521_MUL(a[1], b[2]) +
+           P521_MUL(a[2], b[1]) + P521_MUL(a[3], b[0]) +
+           P521_MUL(a[4], b2[8]) + P521_MUL(a[5], b2[7]) +
+           P521_MUL(a[6], b2[6]) + P521_MUL(a[7], b2[5]) +
+           P521_MUL(a[8], b2[4]);
+    t[4] = P521_MUL(a[0], b[4]) + P521_MUL(a[1], b[3]) +
+           P521_MUL(a[2], b[2]) + P521_MUL(a[3], b[1]) +
+           P521_MUL(a[4], b[0]) + P521_MUL(a[5], b2[8]) +
+           P521_MUL(a[6], b2[7]) + P521_MUL(a[7], b2[6]) +
+           P521_MUL(a[8], b2[5]);
+    t[5] = P521_MUL(a[0], b[5]) + P521_MUL(a[1], b[4]) +
+           P521_MUL(a[2], b[3]) + P521_MUL(a[3], b[2]) +
+           P521_MUL(a[4], b[1]) + P521_MUL(a[5], b[0]) +
+           P521_MUL(a[6], b2[8]) + P521_MUL(a[7], b2[7]) +
+           P521_MUL(a[8], b2[6]);
+    t[6] = P521_MUL(a[0], b[6]) + P521_MUL(a[1], b[5]) +
+           P521_MUL(a[2], b[4]) + P521_MUL(a[3], b[3]) +
+           P521_MUL(a[4], b[2]) + P521_MUL(a[5], b[1]) +
+           P521_MUL(a[6], b[0]) + P521_MUL(a[7], b2[8]) +
+           P521_MUL(a[8], b2[7]);
+    t[7] = P521_MUL(a[0], b[7]) + P521_MUL(a[1], b[6]) +
+           P521_MUL(a[2], b[5]) + P521_MUL(a[3], b[4]) +
+           P521_MUL(a[4], b[3]) + P521_MUL(a[5], b[2]) +
+           P521_MUL(a[6], b[1]) + P521_MUL(a[7], b[0]) +
+           P521_MUL(a[8], b2[8]);
+    t[8] = P521_MUL(a[0], b[8]) + P521_MUL(a[1], b[7]) +
+           P521_MUL(a[2], b[6]) + P521_MUL(a[3], b[5]) +
+           P521_MUL(a[4], b[4]) + P521_MUL(a[5], b[3]) +
+           P521_MUL(a[6], b[2]) + P521_MUL(a[7], b[1]) + P521_MUL(a[8], b[0]);
+    reduce58(result, t);
+    strict_clean(t);
+    strict_clean(b2);
+}
+
+// Squares a value in 58-bit limb form and reduces the result.  This is
+// the same as mul58() except that the cross products are only computed
+// once and doubled, using a2 = 2 * a and a4 = 4 * a for folded columns.
+static void square58(limb_t *result, const uint64_t *a)
+{
+    unsigned __int128 t[9];
+    uint64_t a2[9];
+    uint64_t a4[9];
+    uint8_t i;
+    for (i = 0; i < 9; ++i) {
+        a2[i] = a[i] << 1;
+        a4[i] = a[i] << 2;
+    }
+    t[0] = P521_MUL(a[0], a[0]) + P521_MUL(a[1], a4[8]) +
+           P521_MUL(a[2], a4[7]) + P521_MUL(a[3], a4[6]) +
+           P521_MUL(a[4], a4[5]);
+    t[1] = P521_MUL(a[0], a2[1]) + P521_MUL(a[2], a4[8]) +
+           P521_MUL(a[3], a4[7]) + P521_MUL(a[4], a4[6]) +
+           P521_MUL(a[5], a2[5]);
+    t[2] = P521_MUL(a[0], a2[2]) + P521_MUL(a[1], a[1]) +
+           P521_MUL(a[3], a4[8]) + P521_MUL(a[4], a4[7]) +
+           P521_MUL(a[5], a4[6]);
+    t[3] = P521_MUL(a[0], a2[3]) + P521_MUL(a[1], a2[2]) +
+           P521_MUL(a[4], a4[8]) + P521_MUL(a[5], a4[7]) +
+           P521_MUL(a[6], a2[6]);
+    t[4] = P521_MUL(a[0], a2[4]) + P521_MUL(a[1], a2[3]) +
+           P521_MUL(a[2], a[2]) + P521_MUL(a[5], a4[8]) +
+           P521_MUL(a[6], a4[7]);
+    t[5] = P521_MUL(a[0], a2[5]) + P521_MUL(a[1], a2[4]) +
+           P521_MUL(a[2], a2[3]) + P521_MUL(a[6], a4[8]) +
+           P521_MUL(a[7], a2[7]);
+    t[6] = P521_MUL(a[0], a2[6]) + P521_MUL(a[1], a2[5]) +
+           P521_MUL(a[2], a2[4]) + P521_MUL(a[3], a[3]) +
+           P521_MUL(a[7], a4[8]);
+    t[7] = P521_MUL(a[0], a2[7]) + P521_MUL(a[1], a2[6]) +
+           P521_MUL(a[2], a2[5]) + P521_MUL(a[3], a2[4]) +
+           P521_MUL(a[8], a2[8]);
+    t[8] = P521_MUL(a[0], a2[8]) + P521_MUL(a[1], a2[7]) +
+           P521_MUL(a[2], a2[6]) + P521_MUL(a[3], a2[5]) +
+           P521_MUL(a[4], a[4]);
+    reduce58(result, t);
+    strict_clean(t);
+    strict_clean(a2);
+    strict_clean(a4);
+}
+
+#endif
+
 /**
  * \brief Multiplies two values and then reduces the result modulo 2^521 - 1.
  *
@@ -958,13 +1930,31 @@ void P521::mulNoReduce(limb_t *result, const limb_t *x, const limb_t *y)
  * in size and less than 2^521 - 1.
  * \param y The second value to multiply, which must be NUM_LIMBS_521BIT limbs
  * in size and less than 2^521 - 1.  This can be the same array as \a x.
+ *
+ * On 64-bit platforms the values are converted into nine 58-bit limbs
+ * internally and squaring is detected when \a x and \a y are the same
+ * array.  The result is always fully reduced in the normal limb format.
  */
 void P521::mul(limb_t *result, const limb_t *x, const limb_t *y)
 {
+#if BIGNUMBER_LIMB_64BIT
+    uint64_t a[9];
+    uint64_t b[9];
+    unpack58(a, x);
+    if (x != y) {
+        unpack58(b, y);
+        mul58(result, a, b);
+    } else {
+        square58(result, a);
+    }
+    strict_clean(a);
+    strict_clean(b);
+#else
     limb_t temp[NUM_LIMBS_1042BIT];
     mulNoReduce(temp, x, y);
     reduce(result, temp);
     strict_clean(temp);
+#endif
     crypto_feed_watchdog();
 }
 
@@ -1258,6 +2248,206 @@ void P521::addPoint(limb_t *xout, limb_t *yout, limb_t *zout,
     strict_clean(v);
 }
 
+/**
+ * \brief Adds two curve points that are both represented in Jacobian
+ * co-ordinates.
+ *
+ * \param xout The X value for the result.
+ * \param yout The Y value for the result.
+ * \param zout The Z value for the result.
+ * \param x1 The X value for the first point to add.
+ * \param y1 The Y value for the first point to add.
+ * \param z1 The Z value for the first point to add.
+ * \param x2 The X value for the second point to add.
+ * \param y2 The Y value for the second point to add.
+ * \param z2 The Z value for the second point to add.
+ *
+ * The output parameters must not overlap with either of the inputs.
+ *
+ * The second point must not be the point-at-infinity, and the two
+ * points must not be equal.
+ *
+ * Reference: http://hyperelliptic.org/EFD/g1p/auto-shortw-jacobian-3.html#addition-add-2007-bl
+ */
+void P521::addPoint(limb_t *xout, limb_t *yout, limb_t *zout,
+                    const limb_t *x1, const limb_t *y1,
+                    const limb_t *z1, const limb_t *x2,
+                    const limb_t *y2, const limb_t *z2)
+{
+    limb_t z1z1[NUM_LIMBS_521BIT];
+    limb_t z2z2[NUM_LIMBS_521BIT];
+    limb_t u1[NUM_LIMBS_521BIT];
+    limb_t u2[NUM_LIMBS_521BIT];
+    limb_t s1[NUM_LIMBS_521BIT];
+    limb_t s2[NUM_LIMBS_521BIT];
+    limb_t h[NUM_LIMBS_521BIT];
+    limb_t i[NUM_LIMBS_521BIT];
+    limb_t j[NUM_LIMBS_521BIT];
+
+    // Determine if the first value is the point-at-infinity identity element.
+    limb_t p1IsIdentity = BigNumberUtil::isZero(z1, NUM_LIMBS_521BIT);
+
+    // Add the points.
+    square(z1z1, z1);               // z1z1 = z1^2
+    square(z2z2, z2);               // z2z2 = z2^2
+    mul(u1, x1, z2z2);              // u1 = x1 * z2z2
+    mul(u2, x2, z1z1);              // u2 = x2 * z1z1
+    mul(s1, y1, z2);                // s1 = y1 * z2 * z2z2
+    mul(s1, s1, z2z2);
+    mul(s2, y2, z1);                // s2 = y2 * z1 * z1z1
+    mul(s2, s2, z1z1);
+    sub(h, u2, u1);                 // h = u2 - u1
+    add(i, h, h);                   // i = (2 * h)^2
+    square(i, i);
+    mul(j, h, i);                   // j = h * i
+    sub(s2, s2, s1);                // r = 2 * (s2 - s1), stored in s2
+    add(s2, s2, s2);
+    mul(u1, u1, i);                 // v = u1 * i, stored in u1
+    square(xout, s2);               // xout = r^2 - j - 2 * v
+    sub(xout, xout, j);
+    sub(xout, xout, u1);
+    sub(xout, xout, u1);
+    sub(yout, u1, xout);            // yout = r * (v - xout) - 2 * s1 * j
+    mul(yout, s2, yout);
+    mul(j, s1, j);
+    sub(yout, yout, j);
+    sub(yout, yout, j);
+    add(zout, z1, z2);              // zout = ((z1 + z2)^2 - z1z1 - z2z2) * h
+    square(zout, zout);
+    sub(zout, zout, z1z1);
+    sub(zout, zout, z2z2);
+    mul(zout, zout, h);
+
+    // If (x1, y1, z1) was the identity, then the answer is (x2, y2, z2).
+    cmove(p1IsIdentity, xout, x2);
+    cmove(p1IsIdentity, yout, y2);
+    cmove(p1IsIdentity, zout, z2);
+
+    // Clean up.
+    strict_clean(z1z1);
+    strict_clean(z2z2);
+    strict_clean(u1);
+    strict_clean(u2);
+    strict_clean(s1);
+    strict_clean(s2);
+    strict_clean(h);
+    strict_clean(i);
+    strict_clean(j);
+}
+
+/**
+ * \brief Adds a curve point to a Jacobian accumulator in variable time.
+ *
+ * \param x1 The X value for the first point to add, and the result.
+ * \param y1 The Y value for the first point to add, and the result.
+ * \param z1 The Z value for the first point to add, and the result.
+ * \param x2 The X value for the second point to add.
+ * \param y2 The Y value for the second point to add.
+ * \param z2 The Z value for the second point to add, or NULL if the
+ * second point is in affine co-ordinates.
+ *
+ * Unlike addPoint(), this function handles all of the special cases:
+ * the first point being the point-at-infinity, the two points being
+ * equal, and the two points being the negation of each other.  The
+ * second point must not be the point-at-infinity.
+ *
+ * The timing of this function depends upon the points, so it must
+ * only be used on public values.
+ *
+ * Reference: http://hyperelliptic.org/EFD/g1p/auto-shortw-jacobian-3.html#addition-add-2007-bl
+ */
+void P521::addPointVarTime(limb_t *x1, limb_t *y1, limb_t *z1,
+                           const limb_t *x2, const limb_t *y2,
+                           const limb_t *z2)
+{
+    limb_t z1z1[NUM_LIMBS_521BIT];
+    limb_t z2z2[NUM_LIMBS_521BIT];
+    limb_t u1[NUM_LIMBS_521BIT];
+    limb_t u2[NUM_LIMBS_521BIT];
+    limb_t s1[NUM_LIMBS_521BIT];
+    limb_t s2[NUM_LIMBS_521BIT];
+    limb_t h[NUM_LIMBS_521BIT];
+    limb_t i[NUM_LIMBS_521BIT];
+    limb_t j[NUM_LIMBS_521BIT];
+
+    // If the first point is the identity, then the answer is the second.
+    if (BigNumberUtil::isZero(z1, NUM_LIMBS_521BIT)) {
+        memcpy(x1, x2, sizeof(u1));
+        memcpy(y1, y2, sizeof(u1));
+        if (z2) {
+            memcpy(z1, z2, sizeof(u1));
+        } else {
+            memset(z1, 0, sizeof(u1));
+            z1[0] = 1;
+        }
+        return;
+    }
+
+    // Bring both points to a common denominator.
+    square(z1z1, z1);               // z1z1 = z1^2
+    mul(u2, x2, z1z1);              // u2 = x2 * z1z1
+    mul(s2, y2, z1);                // s2 = y2 * z1 * z1z1
+    mul(s2, s2, z1z1);
+    if (z2) {
+        square(z2z2, z2);           // z2z2 = z2^2
+        mul(u1, x1, z2z2);          // u1 = x1 * z2z2
+        mul(s1, y1, z2);            // s1 = y1 * z2 * z2z2
+        mul(s1, s1, z2z2);
+    } else {
+        memcpy(u1, x1, sizeof(u1));
+        memcpy(s1, y1, sizeof(s1));
+    }
+    sub(h, u2, u1);                 // h = u2 - u1
+    sub(s2, s2, s1);                // r = 2 * (s2 - s1), stored in s2
+
+    // If the x values are the same, then the points are either equal
+    // or the negation of each other.
+    if (BigNumberUtil::isZero(h, NUM_LIMBS_521BIT)) {
+        if (BigNumberUtil::isZero(s2, NUM_LIMBS_521BIT))
+            dblPoint(x1, y1, z1, x1, y1, z1);
+        else
+            memset(z1, 0, sizeof(u1));
+        return;
+    }
+
+    // Add the points.
+    add(s2, s2, s2);
+    add(i, h, h);                   // i = (2 * h)^2
+    square(i, i);
+    mul(j, h, i);                   // j = h * i
+    mul(u1, u1, i);                 // v = u1 * i, stored in u1
+    square(x1, s2);                 // x1 = r^2 - j - 2 * v
+    sub(x1, x1, j);
+    sub(x1, x1, u1);
+    sub(x1, x1, u1);
+    sub(y1, u1, x1);                // y1 = r * (v - x1) - 2 * s1 * j
+    mul(y1, s2, y1);
+    mul(j, s1, j);
+    sub(y1, y1, j);
+    sub(y1, y1, j);
+    if (z2) {
+        add(u2, z1, z2);            // z1 = ((z1 + z2)^2 - z1z1 - z2z2) * h
+        square(u2, u2);
+        sub(u2, u2, z1z1);
+        sub(u2, u2, z2z2);
+        mul(z1, u2, h);
+    } else {
+        mul(z1, z1, h);             // z1 = 2 * z1 * h
+        add(z1, z1, z1);
+    }
+
+    // Clean up.
+    strict_clean(z1z1);
+    strict_clean(z2z2);
+    strict_clean(u1);
+    strict_clean(u2);
+    strict_clean(s1);
+    strict_clean(s2);
+    strict_clean(h);
+    strict_clean(i);
+    strict_clean(j);
+}
+
 /**
  * \brief Conditionally moves \a y into \a x if a selection value is non-zero.
  *
@@ -1502,20 +2692,85 @@ void P521::recipQ(limb_t *result, const limb_t *x)
     }
 }
 
-/**
- * \brief Generates a k value using the algorithm from RFC 6979.
- *
- * \param k The value to generate.
- * \param hm The hashed message formatted ready to be signed.
- * \param x The private key to sign with.
- * \param hash The hash algorithm to use.
- * \param count Iteration counter for generating new values of k when the
- * previous one is rejected.
- */
-void P521::generateK(uint8_t k[66], const uint8_t hm[66],
-                     const uint8_t x[66], Hash *hash, uint64_t count)
+// HMAC-DRBG engine for RFC 6979 that works with any Hash object.  Every
+// HMAC goes through resetHMAC() and finalizeHMAC(), which absorb the key
+// pads again each time because a Hash cannot save and restore its state.
+class P521HashDRBG
+{
+public:
+    explicit P521HashDRBG(Hash *hash) : hash(hash), key(0), keyLen(0) {}
+
+    size_t hashSize() const { return hash->hashSize(); }
+
+    void setKey(const uint8_t *K, size_t len)
+    {
+        key = K;
+        keyLen = len;
+        hash->resetHMAC(key, keyLen);
+    }
+    void reset() { hash->resetHMAC(key, keyLen); }
+    void update(const void *data, size_t len) { hash->update(data, len); }
+    void finalize(uint8_t *mac, size_t len)
+    {
+        hash->finalizeHMAC(key, keyLen, mac, len);
+    }
+
+private:
+    Hash *hash;
+    const uint8_t *key;
+    size_t keyLen;
+};
+
+// HMAC-DRBG engine for RFC 6979 that absorbs the key pads once for each
+// new K and then restores the saved inner and outer states for every
+// HMAC under that K, in the same way as HMACKey.  T is a concrete Hash
+// class with a block size of at most 128 bytes, so none of the calls
+// into the hash states go through the vtable.
+template <typename T>
+class P521CachedDRBG
+{
+public:
+    size_t hashSize() const { return work.hashSize(); }
+
+    void setKey(const uint8_t *K, size_t len)
+    {
+        uint8_t block[128];
+        size_t blockSize = work.blockSize();
+        size_t index;
+        inner.resetHMAC(K, len);
+        for (index = 0; index < len; ++index)
+            block[index] = K[index] ^ 0x6A;
+        memset(block + len, 0x6A, blockSize - len);
+        outer.resetHMAC(block, blockSize);
+        work = inner;
+        clean(block);
+    }
+    void reset() { work = inner; }
+    void update(const void *data, size_t len) { work.update(data, len); }
+    void finalize(uint8_t *mac, size_t len)
+    {
+        uint8_t temp[64];
+        size_t size = work.hashSize();
+        work.finalize(temp, size);
+        work = outer;
+        work.update(temp, size);
+        work.finalize(mac, len);
+        clean(temp);
+    }
+
+private:
+    T inner;
+    T outer;
+    T work;
+};
+
+// Runs the HMAC-DRBG from RFC 6979, Section 3.2 on a DRBG engine
+// to produce the k value for signing with the private key x.
+template <typename DRBG>
+static void generateKWith(DRBG &drbg, uint8_t k[66], const uint8_t hm[66],
+                          const uint8_t x[66], uint64_t count)
 {
-    size_t hlen = hash->hashSize();
+    size_t hlen = drbg.hashSize();
     uint8_t V[64];
     uint8_t K[64];
     uint8_t marker;
@@ -1544,36 +2799,36 @@ void P521::generateK(uint8_t k[66], const uint8_t hm[66],
     // difficult to access, so instead modify K and V in steps d and f.
     // This alternative construction is compatible with the second
     // variant described in section 3.6 of RFC 6979.
-    hash->resetHMAC(K, hlen);
-    hash->update(V, hlen);
+    drbg.setKey(K, hlen);
+    drbg.update(V, hlen);
     marker = 0x00;
-    hash->update(&marker, 1);
-    hash->update(x, 66);
-    hash->update(hm, 66);
+    drbg.update(&marker, 1);
+    drbg.update(x, 66);
+    drbg.update(hm, 66);
     if (count)
-        hash->update(&count, sizeof(count));
-    hash->finalizeHMAC(K, hlen, K, hlen);
+        drbg.update(&count, sizeof(count));
+    drbg.finalize(K, hlen);
 
     // Step e.  V = HMAC_K(V)
-    hash->resetHMAC(K, hlen);
-    hash->update(V, hlen);
-    hash->finalizeHMAC(K, hlen, V, hlen);
+    drbg.setKey(K, hlen);
+    drbg.update(V, hlen);
+    drbg.finalize(V, hlen);
 
     // Step f.  K = HMAC_K(V || 0x01 || x || hm)
-    hash->resetHMAC(K, hlen);
-    hash->update(V, hlen);
+    drbg.reset();
+    drbg.update(V, hlen);
     marker = 0x01;
-    hash->update(&marker, 1);
-    hash->update(x, 66);
-    hash->update(hm, 66);
+    drbg.update(&marker, 1);
+    drbg.update(x, 66);
+    drbg.update(hm, 66);
     if (count)
-        hash->update(&count, sizeof(count));
-    hash->finalizeHMAC(K, hlen, K, hlen);
+        drbg.update(&count, sizeof(count));
+    drbg.finalize(K, hlen);
 
     // Step g.  V = HMAC_K(V)
-    hash->resetHMAC(K, hlen);
-    hash->update(V, hlen);
-    hash->finalizeHMAC(K, hlen, V, hlen);
+    drbg.setKey(K, hlen);
+    drbg.update(V, hlen);
+    drbg.finalize(V, hlen);
 
     // Step h.  Generate candidate k values until we find what we want.
     for (;;) {
@@ -1582,17 +2837,27 @@ void P521::generateK(uint8_t k[66], const uint8_t hm[66],
         //      while (len(T) < 66)
         //          V = HMAC_K(V)
         //          T = T || V
+        // Whole blocks of output are written directly into k and the
+        // next block is generated from there.  Only a partial block
+        // at the end needs to go through V.
+        const uint8_t *prev = V;
         size_t posn = 0;
         while (posn < 66) {
-            size_t temp = 66 - posn;
-            if (temp > hlen)
-                temp = hlen;
-            hash->resetHMAC(K, hlen);
-            hash->update(V, hlen);
-            hash->finalizeHMAC(K, hlen, V, hlen);
-            memcpy(k + posn, V, temp);
-            posn += temp;
+            drbg.reset();
+            drbg.update(prev, hlen);
+            if ((66 - posn) >= hlen) {
+                drbg.finalize(k + posn, hlen);
+                prev = k + posn;
+                posn += hlen;
+            } else {
+                drbg.finalize(V, hlen);
+                memcpy(k + posn, V, 66 - posn);
+                prev = V;
+                posn = 66;
+            }
         }
+        if (prev != V)
+            memcpy(V, prev, hlen);
 
         // Step h.3.  k = bits2int(T) and exit the loop if k is not in
         // the range 1 to q - 1.  Note: We have to extract the 521 most
@@ -1601,20 +2866,20 @@ void P521::generateK(uint8_t k[66], const uint8_t hm[66],
         for (posn = 65; posn > 0; --posn)
             k[posn] = (k[posn - 1] << 1) | (k[posn] >> 7);
         k[0] >>= 7;
-        if (isValidPrivateKey(k))
+        if (P521::isValidPrivateKey(k))
             break;
 
         // Generate new K and V values and try again.
         //      K = HMAC_K(V || 0x00)
         //      V = HMAC_K(V)
-        hash->resetHMAC(K, hlen);
-        hash->update(V, hlen);
+        drbg.reset();
+        drbg.update(V, hlen);
         marker = 0x00;
-        hash->update(&marker, 1);
-        hash->finalizeHMAC(K, hlen, K, hlen);
-        hash->resetHMAC(K, hlen);
-        hash->update(V, hlen);
-        hash->finalizeHMAC(K, hlen, V, hlen);
+        drbg.update(&marker, 1);
+        drbg.finalize(K, hlen);
+        drbg.setKey(K, hlen);
+        drbg.update(V, hlen);
+        drbg.finalize(V, hlen);
     }
 
     // Clean up.
@@ -1622,6 +2887,23 @@ void P521::generateK(uint8_t k[66], const uint8_t hm[66],
     clean(K);
 }
 
+/**
+ * \brief Generates a k value using the algorithm from RFC 6979.
+ *
+ * \param k The value to generate.
+ * \param hm The hashed message formatted ready to be signed.
+ * \param x The private key to sign with.
+ * \param hash The hash algorithm to use.
+ * \param count Iteration counter for generating new values of k when the
+ * previous one is rejected.
+ */
+void P521::generateK(uint8_t k[66], const uint8_t hm[66],
+                     const uint8_t x[66], Hash *hash, uint64_t count)
+{
+    P521HashDRBG drbg(hash);
+    generateKWith(drbg, k, hm, x, count);
+}
+
 /**
  * \brief Generates a k value using the algorithm from RFC 6979.
  *
@@ -1633,10 +2915,12 @@ void P521::generateK(uint8_t k[66], const uint8_t hm[66],
  *
  * This override uses SHA512 to generate k values.  It is used when
  * sign() was not passed an explicit hash object by the application.
+ * The HMAC key pads are absorbed once for each new K rather than once
+ * for each HMAC, and the SHA512 calls are bound at compile time.
  */
 void P521::generateK(uint8_t k[66], const uint8_t hm[66],
                      const uint8_t x[66], uint64_t count)
 {
-    SHA512 hash;
-    generateK(k, hm, x, &hash, count);
+    P521CachedDRBG<SHA512> drbg;
+    generateKWith(drbg, k, hm, x, count);
 }
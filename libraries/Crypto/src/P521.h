@@ -59,9 +59,10 @@ public:
 private:
 #endif
     static void evaluate(limb_t *x, limb_t *y, const uint8_t f[66]);
-
-    static void addAffine(limb_t *x1, limb_t *y1,
-                          const limb_t *x2, const limb_t *y2);
+    static void evaluateGenerator(limb_t *x, limb_t *y, const uint8_t f[66]);
+    static void normalizePoints(limb_t *points, uint8_t count);
+    static bool evaluateJoint(limb_t *x, limb_t *y, const uint8_t f1[66],
+                              const uint8_t f2[66]);
 
     static bool validate(const limb_t *x, const limb_t *y);
     static bool inRange(const limb_t *x);
@@ -89,6 +90,13 @@ private:
                          const limb_t *x1, const limb_t *y1,
                          const limb_t *z1, const limb_t *x2,
                          const limb_t *y2);
+    static void addPoint(limb_t *xout, limb_t *yout, limb_t *zout,
+                         const limb_t *x1, const limb_t *y1,
+                         const limb_t *z1, const limb_t *x2,
+                         const limb_t *y2, const limb_t *z2);
+    static void addPointVarTime(limb_t *x1, limb_t *y1, limb_t *z1,
+                                const limb_t *x2, const limb_t *y2,
+                                const limb_t *z2);
 
     static void cmove(limb_t select, limb_t *x, const limb_t *y);
     static void cmove1(limb_t select, limb_t *x);
@@ -55,6 +55,12 @@
  * caller to encrypt the nonce which gives the caller more flexibility as
  * to how to derive and/or encrypt the nonce.
  *
+ * On 64-bit hosts the accumulator is kept in 44-bit limbs and whole blocks
+ * are processed directly from the caller's buffer.  On x86-64 hosts with
+ * AVX2, runs of eight or more blocks are processed four at a time using
+ * the powers r<sup>2</sup>, r<sup>3</sup>, and r<sup>4</sup> that are
+ * computed by reset().
+ *
  * References: http://en.wikipedia.org/wiki/Poly1305-AES,
  * http://cr.yp.to/mac.html
  */
@@ -76,6 +82,12 @@
 #define lelimbtoh(x)        (le64toh((x)))
 #define htolelimb(x)        (htole64((x)))
 #endif
+#if defined(CRYPTO_POLY1305_RADIX44)
+#define POLY1305_MASK42     0x000003FFFFFFFFFFULL
+#define POLY1305_MASK44     0x00000FFFFFFFFFFFULL
+#define POLY1305_HIBIT44    0x0000010000000000ULL
+#endif
+
 #if defined(CRYPTO_LITTLE_ENDIAN)
 #define littleToHost(r,size)    do { ; } while (0)
 #else
@@ -126,6 +138,18 @@ void Poly1305::reset(const void *key)
     // Convert into little-endian if necessary.
     littleToHost(state.r, NUM_LIMBS_128BIT);
 
+#if defined(CRYPTO_POLY1305_RADIX44)
+    // Split r into 44-bit limbs for processBlocks().
+    state.r44[0] = state.r[0] & POLY1305_MASK44;
+    state.r44[1] = ((state.r[0] >> 44) | (state.r[1] << 20)) & POLY1305_MASK44;
+    state.r44[2] = state.r[1] >> 24;
+    memset(state.h44, 0, sizeof(state.h44));
+#if defined(CRYPTO_POLY1305_SIMD)
+    if (simdAvailable())
+        simdInit(state.rpow, state.r44);
+#endif
+#endif
+
     // Reset the hashing process.
     state.chunkSize = 0;
     memset(state.h, 0, sizeof(state.h));
@@ -147,6 +171,16 @@ void Poly1305::update(const void *data, size_t len)
     // Break the input up into 128-bit chunks and process each in turn.
     const uint8_t *d = (const uint8_t *)data;
     while (len > 0) {
+#if defined(CRYPTO_POLY1305_RADIX44)
+        // Process whole blocks directly from the input if possible.
+        if (state.chunkSize == 0 && len >= 16) {
+            size_t blocks = len / 16;
+            processBlocks(d, blocks, POLY1305_HIBIT44);
+            d += blocks * 16;
+            len -= blocks * 16;
+            continue;
+        }
+#endif
         uint8_t size = 16 - state.chunkSize;
         if (size > len)
             size = len;
@@ -155,9 +189,13 @@ void Poly1305::update(const void *data, size_t len)
         len -= size;
         d += size;
         if (state.chunkSize == 16) {
+#if defined(CRYPTO_POLY1305_RADIX44)
+            processBlocks((const uint8_t *)state.c, 1, POLY1305_HIBIT44);
+#else
             littleToHost(state.c, NUM_LIMBS_128BIT);
             state.c[NUM_LIMBS_128BIT] = 1;
             processChunk();
+#endif
             state.chunkSize = 0;
         }
     }
@@ -190,11 +228,31 @@ void Poly1305::finalize(const void *nonce, void *token, size_t len)
         uint8_t *c = (uint8_t *)state.c;
         c[state.chunkSize] = 1;
         memset(c + state.chunkSize + 1, 0, 16 - state.chunkSize - 1);
+#if defined(CRYPTO_POLY1305_RADIX44)
+        processBlocks(c, 1, 0);
+#else
         littleToHost(state.c, NUM_LIMBS_128BIT);
         state.c[NUM_LIMBS_128BIT] = 0;
         processChunk();
+#endif
     }
 
+#if defined(CRYPTO_POLY1305_RADIX44)
+    // Propagate the carries and convert h back into 64-bit limbs.
+    {
+        uint64_t h0 = state.h44[0];
+        uint64_t h1 = state.h44[1];
+        uint64_t h2 = state.h44[2];
+        h1 += h0 >> 44;
+        h0 &= POLY1305_MASK44;
+        h2 += h1 >> 44;
+        h1 &= POLY1305_MASK44;
+        state.h[0] = h0 | (h1 << 44);
+        state.h[1] = (h1 >> 20) | (h2 << 24);
+        state.h[2] = h2 >> 40;
+    }
+#endif
+
     // At this point, processChunk() has left h as a partially reduced
     // result that is less than (2^130 - 5) * 6.  Perform one more
     // reduction and a trial subtraction to produce the final result.
@@ -255,9 +313,13 @@ void Poly1305::pad()
 {
     if (state.chunkSize != 0) {
         memset(((uint8_t *)state.c) + state.chunkSize, 0, 16 - state.chunkSize);
+#if defined(CRYPTO_POLY1305_RADIX44)
+        processBlocks((const uint8_t *)state.c, 1, POLY1305_HIBIT44);
+#else
         littleToHost(state.c, NUM_LIMBS_128BIT);
         state.c[NUM_LIMBS_128BIT] = 1;
         processChunk();
+#endif
         state.chunkSize = 0;
     }
 }
@@ -343,3 +405,90 @@ void Poly1305::processChunk()
     // Leave it as-is for now with h less than (2^130 - 5) * 6.  It is
     // still within a range where the next h * r step will not overflow.
 }
+
+#if defined(CRYPTO_POLY1305_RADIX44)
+
+/**
+ * \brief Multiplies h by r modulo (2^130 - 5) using 44-bit limbs.
+ *
+ * \param h The value to multiply, which is replaced with the result.
+ * \param r The value to multiply by, which must be less than 2^130.
+ *
+ * The result is only partially reduced: h[0] and h[2] are less than 2^44
+ * and 2^42, and h[1] is slightly larger than 2^44 at most.
+ */
+void Poly1305::mulR44(uint64_t *h, const uint64_t *r)
+{
+    // 2^132 is congruent to 20 modulo (2^130 - 5), so the products that
+    // overflow 132 bits are folded back in by multiplying r by 20.
+    uint64_t s1 = r[1] * 20;
+    uint64_t s2 = r[2] * 20;
+    dlimb_t d0, d1, d2;
+    uint64_t c;
+    d0 = ((dlimb_t)(h[0])) * r[0] + ((dlimb_t)(h[1])) * s2 +
+         ((dlimb_t)(h[2])) * s1;
+    d1 = ((dlimb_t)(h[0])) * r[1] + ((dlimb_t)(h[1])) * r[0] +
+         ((dlimb_t)(h[2])) * s2;
+    d2 = ((dlimb_t)(h[0])) * r[2] + ((dlimb_t)(h[1])) * r[1] +
+         ((dlimb_t)(h[2])) * r[0];
+    c = (uint64_t)(d0 >> 44);
+    h[0] = ((uint64_t)d0) & POLY1305_MASK44;
+    d1 += c;
+    c = (uint64_t)(d1 >> 44);
+    h[1] = ((uint64_t)d1) & POLY1305_MASK44;
+    d2 += c;
+    c = (uint64_t)(d2 >> 42);
+    h[2] = ((uint64_t)d2) & POLY1305_MASK42;
+    h[0] += c * 5;
+    c = h[0] >> 44;
+    h[0] &= POLY1305_MASK44;
+    h[1] += c;
+}
+
+/**
+ * \brief Processes whole 128-bit blocks using 44-bit limbs.
+ *
+ * \param data Points to the data to process.
+ * \param blocks The number of 16-byte blocks to process.
+ * \param hibit The padding bit to add at bit 128 of each block, shifted
+ * down by 88 bits; either 2^40 for whole blocks or zero for the final
+ * block if it was padded.
+ */
+void Poly1305::processBlocks(const uint8_t *data, size_t blocks, uint64_t hibit)
+{
+#if defined(CRYPTO_POLY1305_SIMD)
+    // Process long runs of whole blocks four at a time with AVX2.
+    if (hibit && blocks >= 8 && simdAvailable()) {
+        size_t count = blocks & ~((size_t)3);
+        simdBlocks(state.h44, state.rpow, data, count);
+        data += count * 16;
+        blocks -= count;
+    }
+#endif
+
+    // Compute h = ((h + c) * r) mod (2^130 - 5) for each block c.  The
+    // state is copied into local variables so that it can be kept in
+    // registers even though the data pointer may alias it.
+    uint64_t h[3];
+    uint64_t r[3];
+    uint64_t t0, t1;
+    memcpy(h, state.h44, sizeof(h));
+    memcpy(r, state.r44, sizeof(r));
+    while (blocks > 0) {
+        memcpy(&t0, data, 8);
+        memcpy(&t1, data + 8, 8);
+        t0 = le64toh(t0);
+        t1 = le64toh(t1);
+        h[0] += t0 & POLY1305_MASK44;
+        h[1] += ((t0 >> 44) | (t1 << 20)) & POLY1305_MASK44;
+        h[2] += (t1 >> 24) | hibit;
+        mulR44(h, r);
+        data += 16;
+        --blocks;
+    }
+    memcpy(state.h44, h, sizeof(h));
+    clean(h);
+    clean(r);
+}
+
+#endif
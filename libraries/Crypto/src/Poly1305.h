@@ -26,6 +26,19 @@
 #include "BigNumberUtil.h"
 #include <stddef.h>
 
+// On 64-bit hosts, process blocks with h and r split into 44-bit limbs,
+// which keeps the carries in registers.  On x86-64 hosts with AVX2, runs
+// of blocks are also processed four at a time in 26-bit limbs using
+// precomputed powers of r.  Define CRYPTO_NO_POLY1305_RADIX44 or
+// CRYPTO_NO_POLY1305_SIMD to disable these.
+#if BIGNUMBER_LIMB_64BIT && !defined(CRYPTO_NO_POLY1305_RADIX44)
+#define CRYPTO_POLY1305_RADIX44 1
+#if defined(__x86_64__) && defined(__GNUC__) && \
+    !defined(CRYPTO_NO_POLY1305_SIMD)
+#define CRYPTO_POLY1305_SIMD 1
+#endif
+#endif
+
 class Poly1305
 {
 public:
@@ -45,10 +58,27 @@ private:
         limb_t h[(16 / sizeof(limb_t)) + 1];
         limb_t c[(16 / sizeof(limb_t)) + 1];
         limb_t r[(16 / sizeof(limb_t))];
+#if defined(CRYPTO_POLY1305_RADIX44)
+        uint64_t h44[3];
+        uint64_t r44[3];
+#endif
+#if defined(CRYPTO_POLY1305_SIMD)
+        uint32_t rpow[4][5];
+#endif
         uint8_t chunkSize;
     } state;
 
     void processChunk();
+#if defined(CRYPTO_POLY1305_RADIX44)
+    void processBlocks(const uint8_t *data, size_t blocks, uint64_t hibit);
+    static void mulR44(uint64_t *h, const uint64_t *r);
+#endif
+#if defined(CRYPTO_POLY1305_SIMD)
+    static bool simdAvailable();
+    static void simdInit(uint32_t rpow[4][5], const uint64_t *r);
+    static void simdBlocks(uint64_t *h, const uint32_t rpow[4][5],
+                           const uint8_t *data, size_t blocks);
+#endif
 };
 
 #endif
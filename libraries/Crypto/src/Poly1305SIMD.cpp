@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2015 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Poly1305.h"
+#include "Crypto.h"
+#include "utility/EndianUtil.h"
+#include <string.h>
+
+// Poly1305 implementation for x86-64 hosts with AVX2.  Four blocks are
+// processed in parallel by keeping four independent accumulators in the
+// 64-bit lanes of AVX2 registers, each holding a value in 26-bit limbs.
+// The accumulators are multiplied by r^4 after each group of four blocks.
+// After the last group they are multiplied by r^4, r^3, r^2, and r
+// respectively and added together, which gives the same result as
+// processing the blocks one at a time with Horner's rule.
+//
+// Reference: https://eprint.iacr.org/2013/538.pdf
+
+#if defined(CRYPTO_POLY1305_SIMD)
+
+#include <immintrin.h>
+
+#define CRYPTO_POLY1305_SIMD_TARGET __attribute__((target("avx2")))
+
+/** @cond poly1305_simd */
+
+#define MASK26      0x0000000003FFFFFFULL
+#define MASK42      0x000003FFFFFFFFFFULL
+#define MASK44      0x00000FFFFFFFFFFFULL
+
+bool Poly1305::simdAvailable()
+{
+    // -1 until the CPU has been probed, then 0 or 1.  Using
+    // __builtin_cpu_supports() also checks that the operating
+    // system saves the AVX registers.
+    static int available = -1;
+    if (available < 0) {
+        __builtin_cpu_init();
+        available = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return available != 0;
+}
+
+// Converts a value from 44-bit limbs into 26-bit limbs.  The carries are
+// propagated first so that the top limb is at most slightly over 26 bits.
+static void toRadix26(uint32_t *out, const uint64_t *in)
+{
+    uint64_t h0 = in[0];
+    uint64_t h1 = in[1];
+    uint64_t h2 = in[2];
+    h1 += h0 >> 44;
+    h0 &= MASK44;
+    h2 += h1 >> 44;
+    h1 &= MASK44;
+    h0 += (h2 >> 42) * 5;
+    h2 &= MASK42;
+    h1 += h0 >> 44;
+    h0 &= MASK44;
+    h2 += h1 >> 44;
+    h1 &= MASK44;
+    out[0] = (uint32_t)(h0 & MASK26);
+    out[1] = (uint32_t)(((h0 >> 26) | (h1 << 18)) & MASK26);
+    out[2] = (uint32_t)((h1 >> 8) & MASK26);
+    out[3] = (uint32_t)(((h1 >> 34) | (h2 << 10)) & MASK26);
+    out[4] = (uint32_t)(h2 >> 16);
+}
+
+// Converts a value from 26-bit limbs into 44-bit limbs.  The input limbs
+// may be a few bits larger than 26 bits.
+static void fromRadix26(uint64_t *out, uint64_t *t)
+{
+    // Reduce the limbs to 26 bits, folding the overflow back in at the
+    // bottom, and then propagate the carries one more time.
+    uint8_t i;
+    for (i = 0; i < 4; ++i) {
+        t[i + 1] += t[i] >> 26;
+        t[i] &= MASK26;
+    }
+    t[0] += (t[4] >> 26) * 5;
+    t[4] &= MASK26;
+    for (i = 0; i < 4; ++i) {
+        t[i + 1] += t[i] >> 26;
+        t[i] &= MASK26;
+    }
+    out[0] = (t[0] | (t[1] << 26)) & MASK44;
+    out[1] = ((t[1] >> 18) | (t[2] << 8) | (t[3] << 34)) & MASK44;
+    out[2] = (t[3] >> 10) | (t[4] << 16);
+}
+
+void Poly1305::simdInit(uint32_t rpow[4][5], const uint64_t *r)
+{
+    // Compute r, r^2, r^3, and r^4 and convert them into 26-bit limbs.
+    uint64_t p[3];
+    uint8_t i;
+    memcpy(p, r, sizeof(p));
+    toRadix26(rpow[0], p);
+    for (i = 1; i < 4; ++i) {
+        mulR44(p, r);
+        toRadix26(rpow[i], p);
+    }
+    clean(p);
+}
+
+// Loads four blocks and splits them into 26-bit limbs, one block per lane.
+CRYPTO_POLY1305_SIMD_TARGET static inline void loadBlocks
+    (__m256i *m, const uint8_t *data)
+{
+    const __m256i mask = _mm256_set1_epi64x(MASK26);
+    __m256i a = _mm256_loadu_si256((const __m256i *)data);
+    __m256i b = _mm256_loadu_si256((const __m256i *)(data + 32));
+    __m256i lo = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8);
+    __m256i hi = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xD8);
+    m[0] = _mm256_and_si256(lo, mask);
+    m[1] = _mm256_and_si256(_mm256_srli_epi64(lo, 26), mask);
+    m[2] = _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(lo, 52),
+                                            _mm256_slli_epi64(hi, 12)), mask);
+    m[3] = _mm256_and_si256(_mm256_srli_epi64(hi, 14), mask);
+    m[4] = _mm256_or_si256(_mm256_srli_epi64(hi, 40),
+                           _mm256_set1_epi64x(((uint64_t)1) << 24));
+}
+
+#define MUL(a, b)   _mm256_mul_epu32((a), (b))
+#define ADD(a, b)   _mm256_add_epi64((a), (b))
+
+// Computes h = ((h + m) * r) mod (2^130 - 5) in each lane, where s
+// contains 5 * r.  The result is partially reduced to 26-bit limbs.
+CRYPTO_POLY1305_SIMD_TARGET static inline void mulAdd
+    (__m256i *h, const __m256i *m, const __m256i *r, const __m256i *s)
+{
+    const __m256i mask = _mm256_set1_epi64x(MASK26);
+    __m256i h0 = ADD(h[0], m[0]);
+    __m256i h1 = ADD(h[1], m[1]);
+    __m256i h2 = ADD(h[2], m[2]);
+    __m256i h3 = ADD(h[3], m[3]);
+    __m256i h4 = ADD(h[4], m[4]);
+    __m256i d0, d1, d2, d3, d4, c;
+    d0 = ADD(ADD(ADD(ADD(MUL(h0, r[0]), MUL(h1, s[4])), MUL(h2, s[3])),
+                 MUL(h3, s[2])), MUL(h4, s[1]));
+    d1 = ADD(ADD(ADD(ADD(MUL(h0, r[1]), MUL(h1, r[0])), MUL(h2, s[4])),
+                 MUL(h3, s[3])), MUL(h4, s[2]));
+    d2 = ADD(ADD(ADD(ADD(MUL(h0, r[2]), MUL(h1, r[1])), MUL(h2, r[0])),
+                 MUL(h3, s[4])), MUL(h4, s[3]));
+    d3 = ADD(ADD(ADD(ADD(MUL(h0, r[3]), MUL(h1, r[2])), MUL(h2, r[1])),
+                 MUL(h3, r[0])), MUL(h4, s[4]));
+    d4 = ADD(ADD(ADD(ADD(MUL(h0, r[4]), MUL(h1, r[3])), MUL(h2, r[2])),
+                 MUL(h3, r[1])), MUL(h4, r[0]));
+    c = _mm256_srli_epi64(d0, 26);
+    h[0] = _mm256_and_si256(d0, mask);
+    d1 = ADD(d1, c);
+    c = _mm256_srli_epi64(d1, 26);
+    h[1] = _mm256_and_si256(d1, mask);
+    d2 = ADD(d2, c);
+    c = _mm256_srli_epi64(d2, 26);
+    h[2] = _mm256_and_si256(d2, mask);
+    d3 = ADD(d3, c);
+    c = _mm256_srli_epi64(d3, 26);
+    h[3] = _mm256_and_si256(d3, mask);
+    d4 = ADD(d4, c);
+    c = _mm256_srli_epi64(d4, 26);
+    h[4] = _mm256_and_si256(d4, mask);
+    h[0] = ADD(h[0], ADD(c, _mm256_slli_epi64(c, 2)));
+    c = _mm256_srli_epi64(h[0], 26);
+    h[0] = _mm256_and_si256(h[0], mask);
+    h[1] = ADD(h[1], c);
+}
+
+/**
+ * \brief Processes whole blocks four at a time with AVX2.
+ *
+ * \param h The accumulator in 44-bit limbs, which is updated in place.
+ * \param rpow The powers r, r^2, r^3, and r^4 in 26-bit limbs.
+ * \param data Points to the data to process.
+ * \param blocks The number of 16-byte blocks, which must be a non-zero
+ * multiple of 4.
+ */
+CRYPTO_POLY1305_SIMD_TARGET void Poly1305::simdBlocks
+    (uint64_t *h, const uint32_t rpow[4][5], const uint8_t *data, size_t blocks)
+{
+    __m256i acc[5];
+    __m256i m[5];
+    __m256i r[5];
+    __m256i s[5];
+    uint32_t h26[5];
+    uint64_t t[5];
+    uint64_t lanes[4];
+    uint8_t i;
+
+    // Put the incoming accumulator into the first lane.
+    toRadix26(h26, h);
+    for (i = 0; i < 5; ++i)
+        acc[i] = _mm256_set_epi64x(0, 0, 0, h26[i]);
+
+    // Multiply by r^4 after every group except the last.
+    for (i = 0; i < 5; ++i) {
+        r[i] = _mm256_set1_epi64x(rpow[3][i]);
+        s[i] = _mm256_set1_epi64x(rpow[3][i] * 5);
+    }
+    while (blocks > 4) {
+        loadBlocks(m, data);
+        mulAdd(acc, m, r, s);
+        data += 64;
+        blocks -= 4;
+    }
+
+    // Multiply the lanes by r^4, r^3, r^2, and r after the last group.
+    for (i = 0; i < 5; ++i) {
+        r[i] = _mm256_set_epi64x(rpow[0][i], rpow[1][i],
+                                 rpow[2][i], rpow[3][i]);
+        s[i] = ADD(r[i], _mm256_slli_epi64(r[i], 2));
+    }
+    loadBlocks(m, data);
+    mulAdd(acc, m, r, s);
+
+    // Add the lanes together and convert back into 44-bit limbs.
+    for (i = 0; i < 5; ++i) {
+        _mm256_storeu_si256((__m256i *)lanes, acc[i]);
+        t[i] = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    fromRadix26(h, t);
+    clean(h26);
+    clean(t);
+    clean(lanes);
+}
+
+/** @endcond */
+
+#endif // CRYPTO_POLY1305_SIMD
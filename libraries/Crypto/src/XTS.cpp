@@ -155,6 +155,10 @@ bool XTSCommon::setTweak(const uint8_t *tweak, size_t len)
             (output)[i] = (input)[i] ^ ((const uint8_t *)(tweak))[i]; \
     } while (0)
 
+// Number of blocks to encrypt or decrypt at once with encryptBlocks()
+// or decryptBlocks().
+#define XTS_BATCH_BLOCKS 4
+
 /**
  * \brief Encrypts an entire sector of data.
  *
@@ -172,16 +176,24 @@ void XTSCommon::encryptSector(uint8_t *output, const uint8_t *input)
     size_t sectLast = sectSize & ~15;
     size_t posn = 0;
     uint32_t t[4];
+    uint32_t tweaks[XTS_BATCH_BLOCKS][4];
     memcpy(t, twk, sizeof(t));
     while (posn < sectLast) {
-        // Process all complete 16-byte blocks.
-        xorTweak(output, input, t);
-        blockCipher1->encryptBlock(output, output);
-        xorTweak(output, output, t);
-        GF128::dblXTS(t);
-        input += 16;
-        output += 16;
-        posn += 16;
+        // Process all complete 16-byte blocks, several at a time.
+        size_t count = (sectLast - posn) / 16;
+        if (count > XTS_BATCH_BLOCKS)
+            count = XTS_BATCH_BLOCKS;
+        for (size_t index = 0; index < count; ++index) {
+            memcpy(tweaks[index], t, sizeof(t));
+            xorTweak(output + index * 16, input + index * 16, t);
+            GF128::dblXTS(t);
+        }
+        blockCipher1->encryptBlocks(output, output, count);
+        for (size_t index = 0; index < count; ++index)
+            xorTweak(output + index * 16, output + index * 16, tweaks[index]);
+        input += count * 16;
+        output += count * 16;
+        posn += count * 16;
     }
     if (posn < sectSize) {
         // Perform ciphertext stealing on the final partial block.
@@ -217,18 +229,26 @@ void XTSCommon::decryptSector(uint8_t *output, const uint8_t *input)
     size_t sectLast = sectSize & ~15;
     size_t posn = 0;
     uint32_t t[4];
+    uint32_t tweaks[XTS_BATCH_BLOCKS][4];
     memcpy(t, twk, sizeof(t));
     if (sectLast != sectSize)
         sectLast -= 16;
     while (posn < sectLast) {
-        // Process all complete 16-byte blocks.
-        xorTweak(output, input, t);
-        blockCipher1->decryptBlock(output, output);
-        xorTweak(output, output, t);
-        GF128::dblXTS(t);
-        input += 16;
-        output += 16;
-        posn += 16;
+        // Process all complete 16-byte blocks, several at a time.
+        size_t count = (sectLast - posn) / 16;
+        if (count > XTS_BATCH_BLOCKS)
+            count = XTS_BATCH_BLOCKS;
+        for (size_t index = 0; index < count; ++index) {
+            memcpy(tweaks[index], t, sizeof(t));
+            xorTweak(output + index * 16, input + index * 16, t);
+            GF128::dblXTS(t);
+        }
+        blockCipher1->decryptBlocks(output, output, count);
+        for (size_t index = 0; index < count; ++index)
+            xorTweak(output + index * 16, output + index * 16, tweaks[index]);
+        input += count * 16;
+        output += count * 16;
+        posn += count * 16;
     }
     if (posn < sectSize) {
         // Perform ciphertext stealing on the final two blocks.
@@ -260,6 +280,86 @@ void XTSCommon::decryptSector(uint8_t *output, const uint8_t *input)
     }
 }
 
+/**
+ * \brief Encrypts a run of consecutive sectors.
+ *
+ * \param output The output buffer to write the ciphertext to, which can
+ * be the same as \a input.
+ * \param input The input buffer to read the plaintext from.
+ * \param firstSectorNumber The number of the first sector in \a input.
+ * \param count The number of sectors to encrypt.
+ *
+ * The \a input and \a output buffers must be at least \a count *
+ * sectorSize() bytes in length.
+ *
+ * The tweak for each sector is the sector number, formatted as a 16-byte
+ * little-endian value as described in IEEE Std. 1619-2007.  This is
+ * equivalent to calling setTweak() and encryptSector() on each sector
+ * in turn, but the tweaks for several sectors are encrypted at once
+ * with the second block cipher's encryptBlocks() function.
+ *
+ * On exit, the current tweak will be set to the tweak for the last sector.
+ *
+ * \sa decryptSectors(), encryptSector()
+ */
+void XTSCommon::encryptSectors(uint8_t *output, const uint8_t *input,
+                               uint64_t firstSectorNumber, size_t count)
+{
+    uint32_t tweaks[XTS_BATCH_BLOCKS][4];
+    while (count > 0) {
+        size_t batch = count;
+        if (batch > XTS_BATCH_BLOCKS)
+            batch = XTS_BATCH_BLOCKS;
+        sectorTweaks(tweaks, firstSectorNumber, batch);
+        for (size_t index = 0; index < batch; ++index) {
+            memcpy(twk, tweaks[index], sizeof(twk));
+            encryptSector(output, input);
+            input += sectSize;
+            output += sectSize;
+        }
+        firstSectorNumber += batch;
+        count -= batch;
+    }
+    clean(tweaks);
+}
+
+/**
+ * \brief Decrypts a run of consecutive sectors.
+ *
+ * \param output The output buffer to write the plaintext to, which can
+ * be the same as \a input.
+ * \param input The input buffer to read the ciphertext from.
+ * \param firstSectorNumber The number of the first sector in \a input.
+ * \param count The number of sectors to decrypt.
+ *
+ * The \a input and \a output buffers must be at least \a count *
+ * sectorSize() bytes in length.
+ *
+ * On exit, the current tweak will be set to the tweak for the last sector.
+ *
+ * \sa encryptSectors(), decryptSector()
+ */
+void XTSCommon::decryptSectors(uint8_t *output, const uint8_t *input,
+                               uint64_t firstSectorNumber, size_t count)
+{
+    uint32_t tweaks[XTS_BATCH_BLOCKS][4];
+    while (count > 0) {
+        size_t batch = count;
+        if (batch > XTS_BATCH_BLOCKS)
+            batch = XTS_BATCH_BLOCKS;
+        sectorTweaks(tweaks, firstSectorNumber, batch);
+        for (size_t index = 0; index < batch; ++index) {
+            memcpy(twk, tweaks[index], sizeof(twk));
+            decryptSector(output, input);
+            input += sectSize;
+            output += sectSize;
+        }
+        firstSectorNumber += batch;
+        count -= batch;
+    }
+    clean(tweaks);
+}
+
 /**
  * \brief Clears all security-sensitive state from this XTS object.
  */
@@ -270,6 +370,23 @@ void XTSCommon::clear()
     blockCipher2->clear();
 }
 
+// Generates the encrypted tweaks for "count" consecutive sectors
+// starting at "sectorNumber", where "count" is at most XTS_BATCH_BLOCKS.
+void XTSCommon::sectorTweaks(uint32_t tweaks[][4], uint64_t sectorNumber,
+                             size_t count)
+{
+    for (size_t index = 0; index < count; ++index) {
+        uint8_t *t = (uint8_t *)(tweaks[index]);
+        uint64_t number = sectorNumber + index;
+        for (uint8_t posn = 0; posn < 8; ++posn) {
+            t[posn] = (uint8_t)number;
+            number >>= 8;
+        }
+        memset(t + 8, 0, 8);
+    }
+    blockCipher2->encryptBlocks((uint8_t *)tweaks, (uint8_t *)tweaks, count);
+}
+
 /**
  * \fn void XTSCommon::setBlockCiphers(BlockCipher *cipher1, BlockCipher *cipher2)
  * \brief Sets the two block ciphers to use for XTS mode.
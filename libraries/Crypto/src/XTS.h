@@ -44,6 +44,11 @@ public:
     void encryptSector(uint8_t *output, const uint8_t *input);
     void decryptSector(uint8_t *output, const uint8_t *input);
 
+    void encryptSectors(uint8_t *output, const uint8_t *input,
+                        uint64_t firstSectorNumber, size_t count);
+    void decryptSectors(uint8_t *output, const uint8_t *input,
+                        uint64_t firstSectorNumber, size_t count);
+
     void clear();
 
 protected:
@@ -60,6 +65,9 @@ private:
     uint32_t twk[4];
     size_t sectSize;
 
+    void sectorTweaks(uint32_t tweaks[][4], uint64_t sectorNumber,
+                      size_t count);
+
     friend class XTSSingleKeyCommon;
 };
 
@@ -14,10 +14,15 @@
 #include <Arduino.h>
 #include <Adafruit_LittleFS.h>
 #include <InternalFileSystem.h>
+#include <SHA256.h>
 #include <SHA512.h>
+#include <SHA3.h>
+#include <BLAKE2b.h>
+#include <BLAKE2s.h>
 #include <Ed25519.h>
 #include "HSM.h"
 #include "Codex.h"
+#include "Merkle.h"
 
 #define STATE_DIRECTORY    "/cdt"
 #define STATE_FILENAME    "/cdt/state"
@@ -33,11 +38,11 @@ const int MAX_WAIT_MILLISECONDS = 5 /*seconds*/ * 1000;
 
 // STATE MACHINE
 
-const State nextState[3][7] = {
-   // LoadBlock   GenerateKeys   RotateKeys   EraseKeys  DigestBytes  SignBytes  ValidSignature
-    { Invalid,     OneKeyPair,  Invalid,     NoKeyPairs, NoKeyPairs,  Invalid,    NoKeyPairs  }, // NoKeyPairs
-    { Invalid,     Invalid,     TwoKeyPairs, NoKeyPairs, OneKeyPair,  OneKeyPair, OneKeyPair  }, // OneKeyPair
-    { Invalid,     Invalid,     Invalid,     NoKeyPairs, TwoKeyPairs, OneKeyPair, TwoKeyPairs }  // TwoKeyPairs
+const State nextState[3][8] = {
+   // LoadBlock   GenerateKeys   RotateKeys   EraseKeys  DigestBytes  SignBytes  ValidSignature DigestChunks
+    { Invalid,     OneKeyPair,  Invalid,     NoKeyPairs, NoKeyPairs,  Invalid,    NoKeyPairs,    NoKeyPairs  }, // NoKeyPairs
+    { Invalid,     Invalid,     TwoKeyPairs, NoKeyPairs, OneKeyPair,  OneKeyPair, OneKeyPair,    OneKeyPair  }, // OneKeyPair
+    { Invalid,     Invalid,     Invalid,     NoKeyPairs, TwoKeyPairs, OneKeyPair, TwoKeyPairs,   TwoKeyPairs }  // TwoKeyPairs
 };
 
 
@@ -115,6 +120,12 @@ HSM::HSM() {
         Serial.println("The button is enabled.");
         this->hasButton = true;
     }
+    Serial.println("Allocating the digesters...");
+    digesters[DigestSHA512] = new SHA512();
+    digesters[DigestSHA3_512] = new SHA3_512();
+    digesters[DigestBLAKE2b] = new BLAKE2b();
+    digesters[DigestBLAKE2s] = new BLAKE2s();
+    digesters[DigestSHA256] = new SHA256();
     Serial.println("Loading the state of the HSM...");
     InternalFS.begin();
     loadState();
@@ -128,6 +139,10 @@ HSM::~HSM() {
     erase(wearableKey, KEY_SIZE);
     erase(previousPublicKey, KEY_SIZE);
     erase(previousWearableKey, KEY_SIZE);
+    for (size_t i = 0; i < NUMBER_OF_DIGESTERS; i++) {
+        delete digesters[i];
+        digesters[i] = 0;
+    }
 }
 
 
@@ -259,20 +274,33 @@ bool HSM::eraseKeys() {
 }
 
 
+size_t HSM::digestSize(DigestAlgorithm algorithm) {
+    Hash* hash = digester(algorithm);
+    return hash ? hash->hashSize() : 0;
+}
+
+
 // NOTE: The returned digest must be deleted by the calling program.
-const uint8_t* HSM::digestBytes(const uint8_t* bytes, const size_t size) {
+const uint8_t* HSM::digestBytes(const uint8_t* bytes, const size_t size, DigestAlgorithm algorithm) {
     // validate request type
     if (invalidRequest(DigestBytes)) {
         Serial.print("The HSM is in an invalid state for this operation: ");
         Serial.println(currentState);
         return 0;
     }
+    Hash* hash = digester(algorithm);
+    if (!hash) {
+        Serial.print("An unsupported digest algorithm was passed by the mobile device: ");
+        Serial.println(algorithm);
+        return 0;
+    }
 
     // generate the digital digest
-    SHA512 digester;
-    uint8_t* digest = new uint8_t[DIG_SIZE];
-    digester.update((const void*) bytes, size);
-    digester.finalize(digest, DIG_SIZE);
+    size_t length = hash->hashSize();
+    uint8_t* digest = new uint8_t[length];
+    hash->reset();
+    hash->update((const void*) bytes, size);
+    hash->finalize(digest, length);
 
     // update current state
     transitionState(DigestBytes);
@@ -282,6 +310,44 @@ const uint8_t* HSM::digestBytes(const uint8_t* bytes, const size_t size) {
 }
 
 
+// NOTE: The returned root digest must be deleted by the calling program.
+const uint8_t* HSM::digestChunks(
+    const uint8_t* bytes,
+    const size_t size,
+    const size_t chunkSize,
+    DigestAlgorithm algorithm
+) {
+    // validate request type
+    if (invalidRequest(DigestChunks)) {
+        Serial.print("The HSM is in an invalid state for this operation: ");
+        Serial.println(currentState);
+        return 0;
+    }
+    if (chunkSize == 0) {
+        Serial.println("An invalid chunk size was passed by the mobile device.");
+        return 0;
+    }
+    Hash* hash = digester(algorithm);
+    if (!hash) {
+        Serial.print("An unsupported digest algorithm was passed by the mobile device: ");
+        Serial.println(algorithm);
+        return 0;
+    }
+
+    // generate the leaf digests and then the root digest
+    size_t count;
+    uint8_t* leaves = Merkle::digestLeaves(hash, bytes, size, chunkSize, count);
+    uint8_t* digest = Merkle::digestRoot(hash, leaves, count);
+    delete [] leaves;
+
+    // update current state
+    transitionState(DigestChunks);
+    storeState();
+
+    return digest;
+}
+
+
 // NOTE: The returned digital signature must be deleted by the calling program.
 const uint8_t* HSM::signBytes(uint8_t mobileKey[KEY_SIZE], const uint8_t* bytes, const size_t size) {
     // validate request type
@@ -382,6 +448,12 @@ bool HSM::validSignature(
 }
 
 
+Hash* HSM::digester(DigestAlgorithm algorithm) {
+    if (algorithm < 0 || (size_t) algorithm >= NUMBER_OF_DIGESTERS) return 0;
+    return digesters[algorithm];
+}
+
+
 bool HSM::invalidRequest(RequestType request) {
     return nextState[currentState][request] == Invalid;
 }
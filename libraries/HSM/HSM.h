@@ -17,7 +17,7 @@
 #include <stddef.h>
 
 #define KEY_SIZE 32  // key size in bytes
-#define DIG_SIZE 64  // digest size in bytes
+#define DIG_SIZE 64  // maximum digest size in bytes
 #define SIG_SIZE 64  // digital signature size in bytes
 
 
@@ -38,9 +38,21 @@ enum RequestType {
     EraseKeys = 3,
     DigestBytes = 4,
     SignBytes = 5,
-    ValidSignature = 6
+    ValidSignature = 6,
+    DigestChunks = 7
 };
 
+enum DigestAlgorithm {
+    BadAlgorithm = -1,
+    DigestSHA512 = 0,
+    DigestSHA3_512 = 1,
+    DigestBLAKE2b = 2,
+    DigestBLAKE2s = 3,
+    DigestSHA256 = 4
+};
+
+class Hash;
+
 
 // CLASS DEFINITION
 
@@ -52,7 +64,8 @@ enum RequestType {
  *
  * The functions are split into two groups, the first which do not require access to
  * the private key:
- *  * digestBytes(bytes, size) => digest
+ *  * digestBytes(bytes, size, algorithm) => digest
+ *  * digestChunks(bytes, size, chunkSize, algorithm) => root digest
  *  * validSignature(bytes, size, signature, aPublicKey) => isValid?
  *
  * and the second group which do involve the private key which has been encrypted
@@ -157,13 +170,44 @@ class HSM final {
     bool eraseKeys();
 
     /**
-     * This function is passed, from a mobile device, some bytes. It generates, for the
-     * bytes, a digest that can be used later to verify that the bytes have not changed.
-     * No keys are used to generate the digest. The digest is returned from the function.
+     * This function returns the size in bytes of the digests generated using the
+     * specified digest algorithm, or zero if the algorithm is not supported.
+     */
+    size_t digestSize(DigestAlgorithm algorithm);
+
+    /**
+     * This function is passed, from a mobile device, some bytes and optionally the
+     * digest algorithm to be used (SHA512 by default). It generates, for the bytes, a
+     * digest that can be used later to verify that the bytes have not changed. No keys
+     * are used to generate the digest. The digest, which is digestSize(algorithm) bytes
+     * long, is returned from the function.
+     *
      * It is the responsibilty of the calling program to 'delete []' the digest once it
      * has finished with it.
      */
-    const uint8_t* digestBytes(const uint8_t* bytes, const size_t size);
+    const uint8_t* digestBytes(
+        const uint8_t* bytes,
+        const size_t size,
+        DigestAlgorithm algorithm = DigestSHA512
+    );
+
+    /**
+     * This function is passed, from a mobile device, some bytes and a chunk size. It
+     * splits the bytes into chunks of that size and generates, for the bytes, the root
+     * digest of a Merkle tree whose leaves are the digests of the chunks (see Merkle.h).
+     * This allows any single chunk to be verified later against the root digest without
+     * access to the rest of the bytes. No keys are used to generate the digest. The root
+     * digest, which is digestSize(algorithm) bytes long, is returned from the function.
+     *
+     * It is the responsibilty of the calling program to 'delete []' the digest once it
+     * has finished with it.
+     */
+    const uint8_t* digestChunks(
+        const uint8_t* bytes,
+        const size_t size,
+        const size_t chunkSize,
+        DigestAlgorithm algorithm = DigestSHA512
+    );
 
     /**
      * This function is passed, from a mobile device, a mobile key and some bytes to
@@ -201,6 +245,13 @@ class HSM final {
 
   private:
     static const size_t BUFFER_SIZE = 4 * KEY_SIZE + 1;
+    static const size_t NUMBER_OF_DIGESTERS = 5;
+
+    /**
+     * This function returns the digester for the specified digest algorithm, or zero
+     * if the algorithm is not supported.
+     */
+    Hash* digester(DigestAlgorithm algorithm);
 
     /**
      * This function checks to see if the specified request is NOT allowed in the current
@@ -235,6 +286,9 @@ class HSM final {
     uint8_t* previousWearableKey = 0;
     bool hasButton = false;
 
+    // The digesters are allocated once, indexed by DigestAlgorithm.
+    Hash* digesters[NUMBER_OF_DIGESTERS] = { 0 };
+
 };
 
 #endif
@@ -0,0 +1,179 @@
+/************************************************************************
+ * Copyright (c) Crater Dog Technologies(TM).  All Rights Reserved.     *
+ ************************************************************************
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.        *
+ *                                                                      *
+ * This source code is for reference purposes only.  It is protected by *
+ * US Patent 9,853,813 and any use of this source code will be deemed   *
+ * an infringement of the patent.  Crater Dog Technologies(TM) retains  *
+ * full ownership of this source code.  If you are interested in        *
+ * experimenting with, or licensing the technology, please contact us   *
+ * at craterdog@gmail.com                                               *
+ ************************************************************************/
+#include <string.h>
+#include <Hash.h>
+#include "Merkle.h"
+
+
+// CONSTANTS
+
+const uint8_t LEAF_PREFIX = 0x00;
+const uint8_t NODE_PREFIX = 0x01;
+
+
+// FORWARD REFERENCES
+
+void digestNode(Hash* digester, const uint8_t* left, const uint8_t* right, uint8_t* node);
+size_t digestLevel(Hash* digester, uint8_t* nodes, const size_t count);
+
+
+// PUBLIC METHODS
+
+uint8_t* Merkle::digestLeaves(
+    Hash* digester,
+    const uint8_t* bytes,
+    const size_t size,
+    const size_t chunkSize,
+    size_t& count
+) {
+    count = 0;
+    if (chunkSize == 0) return 0;  // the bytes cannot be split into empty chunks
+    const size_t digestSize = digester->hashSize();
+    count = size ? (size + chunkSize - 1) / chunkSize : 1;
+    uint8_t* leaves = new uint8_t[count * digestSize];
+    for (size_t i = 0; i < count; i++) {
+        size_t offset = i * chunkSize;
+        size_t length = size - offset < chunkSize ? size - offset : chunkSize;
+        digestLeaf(digester, bytes + offset, length, leaves + i * digestSize);
+    }
+    return leaves;
+}
+
+void Merkle::digestLeaf(Hash* digester, const uint8_t* chunk, const size_t size, uint8_t* leaf) {
+    digester->reset();
+    digester->update((const void*) &LEAF_PREFIX, 1);
+    digester->update((const void*) chunk, size);
+    digester->finalize(leaf, digester->hashSize());
+}
+
+uint8_t* Merkle::digestRoot(Hash* digester, const uint8_t* leaves, const size_t count) {
+    if (count == 0) return 0;  // a tree must have at least one leaf
+    const size_t digestSize = digester->hashSize();
+    uint8_t* nodes = new uint8_t[count * digestSize];
+    memcpy(nodes, leaves, count * digestSize);
+    size_t remaining = count;
+    while (remaining > 1) {
+        remaining = digestLevel(digester, nodes, remaining);
+    }
+    uint8_t* root = new uint8_t[digestSize];
+    memcpy(root, nodes, digestSize);
+    delete [] nodes;
+    return root;
+}
+
+uint8_t* Merkle::generateProof(
+    Hash* digester,
+    const uint8_t* leaves,
+    const size_t count,
+    const size_t index,
+    size_t& length
+) {
+    length = 0;
+    if (index >= count) return 0;
+    const size_t digestSize = digester->hashSize();
+    uint8_t* nodes = new uint8_t[count * digestSize];
+    memcpy(nodes, leaves, count * digestSize);
+
+    // a proof never needs more siblings than the number of levels in the tree
+    size_t levels = 0;
+    for (size_t remaining = count; remaining > 1; remaining = (remaining + 1) / 2) levels++;
+    uint8_t* proof = new uint8_t[levels ? levels * digestSize : 1];
+
+    // collect the sibling at each level on the path up to the root
+    size_t position = index;
+    size_t remaining = count;
+    while (remaining > 1) {
+        size_t sibling = position ^ 1;
+        if (sibling < remaining) {
+            memcpy(proof + length * digestSize, nodes + sibling * digestSize, digestSize);
+            length++;
+        }
+        remaining = digestLevel(digester, nodes, remaining);
+        position >>= 1;
+    }
+    delete [] nodes;
+    return proof;
+}
+
+bool Merkle::validProof(
+    Hash* digester,
+    const uint8_t* leaf,
+    const size_t index,
+    const size_t count,
+    const uint8_t* proof,
+    const size_t length,
+    const uint8_t* root
+) {
+    if (index >= count) return false;
+    const size_t digestSize = digester->hashSize();
+    uint8_t* node = new uint8_t[digestSize];
+    memcpy(node, leaf, digestSize);
+
+    // walk the path from the leaf up to the root
+    size_t used = 0;
+    size_t position = index;
+    size_t remaining = count;
+    while (remaining > 1) {
+        size_t sibling = position ^ 1;
+        if (sibling < remaining) {
+            if (used == length) break;  // the proof is too short
+            const uint8_t* digest = proof + used * digestSize;
+            if (position & 1) {
+                digestNode(digester, digest, node, node);
+            } else {
+                digestNode(digester, node, digest, node);
+            }
+            used++;
+        }
+        remaining = (remaining + 1) / 2;
+        position >>= 1;
+    }
+    bool isValid = remaining == 1 && used == length && memcmp(node, root, digestSize) == 0;
+    delete [] node;
+    return isValid;
+}
+
+
+// PRIVATE FUNCTIONS
+
+/*
+ * This function generates the digest of an interior node from the digests of its two
+ * children. The node may be the same buffer as either of the children.
+ */
+void digestNode(Hash* digester, const uint8_t* left, const uint8_t* right, uint8_t* node) {
+    const size_t digestSize = digester->hashSize();
+    digester->reset();
+    digester->update((const void*) &NODE_PREFIX, 1);
+    digester->update((const void*) left, digestSize);
+    digester->update((const void*) right, digestSize);
+    digester->finalize(node, digestSize);
+}
+
+/*
+ * This function replaces, in place, a level of nodes with the next level up the tree.
+ * It returns the number of nodes in the new level.
+ */
+size_t digestLevel(Hash* digester, uint8_t* nodes, const size_t count) {
+    const size_t digestSize = digester->hashSize();
+    size_t next = 0;
+    for (size_t i = 0; i + 1 < count; i += 2) {
+        digestNode(digester, nodes + i * digestSize, nodes + (i + 1) * digestSize, nodes + next * digestSize);
+        next++;
+    }
+    if (count & 1) {
+        // promote the odd node at the end of the level
+        memmove(nodes + next * digestSize, nodes + (count - 1) * digestSize, digestSize);
+        next++;
+    }
+    return next;
+}
@@ -0,0 +1,116 @@
+/************************************************************************
+ * Copyright (c) Crater Dog Technologies(TM).  All Rights Reserved.     *
+ ************************************************************************
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.        *
+ *                                                                      *
+ * This source code is for reference purposes only.  It is protected by *
+ * US Patent 9,853,813 and any use of this source code will be deemed   *
+ * an infringement of the patent.  Crater Dog Technologies(TM) retains  *
+ * full ownership of this source code.  If you are interested in        *
+ * experimenting with, or licensing the technology, please contact us   *
+ * at craterdog@gmail.com                                               *
+ ************************************************************************/
+#ifndef MERKLE_H
+#define MERKLE_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+class Hash;
+
+
+/**
+ * This class implements a Merkle tree digest over fixed size chunks of a byte array.
+ * Each chunk is digested independently into a leaf, so the leaves may be generated
+ * in parallel, and a single leaf can be regenerated when its chunk changes without
+ * rereading the rest of the bytes. The root is then generated from the leaves.
+ *
+ * The digests are domain separated as follows (see RFC 6962):
+ *  * leaf = digest(0x00 || chunk)
+ *  * node = digest(0x01 || left || right)
+ *
+ * At each level of the tree the nodes are paired from the left. If a level contains
+ * an odd number of nodes the last node is promoted to the next level unchanged.
+ *
+ * A proof for a leaf contains the sibling digests on the path from the leaf to the
+ * root, ordered from the bottom of the tree up. It allows a single chunk to be
+ * validated against the root without access to any of the other chunks.
+ *
+ * All digests are generated using the specified digester and are digester->hashSize()
+ * bytes long.
+ */
+class Merkle final {
+  public:
+    /**
+     * This function is passed a byte array, its size and a chunk size. It returns an
+     * array containing one leaf digest for each chunk of the byte array, and sets the
+     * count to the number of leaves. The last chunk may be shorter than the chunk
+     * size. An empty byte array has a single (empty) chunk. It returns zero, and sets
+     * the count to zero, if the chunk size is zero.
+     *
+     * It is the responsibilty of the calling program to 'delete []' the leaves once
+     * it has finished with them.
+     */
+    static uint8_t* digestLeaves(
+        Hash* digester,
+        const uint8_t* bytes,
+        const size_t size,
+        const size_t chunkSize,
+        size_t& count
+    );
+
+    /**
+     * This function is passed a single chunk of bytes and generates its leaf digest.
+     * It can be used to digest the chunks in parallel, or to regenerate the leaf for
+     * a chunk that has changed.
+     */
+    static void digestLeaf(Hash* digester, const uint8_t* chunk, const size_t size, uint8_t* leaf);
+
+    /**
+     * This function is passed an array of leaf digests and returns the root digest
+     * of the corresponding Merkle tree. It returns zero if the count is zero.
+     *
+     * It is the responsibilty of the calling program to 'delete []' the root once it
+     * has finished with it.
+     */
+    static uint8_t* digestRoot(Hash* digester, const uint8_t* leaves, const size_t count);
+
+    /**
+     * This function is passed an array of leaf digests and the index of one of the
+     * leaves. It returns the proof for that leaf and sets the length to the number
+     * of digests in the proof. It returns zero, and sets the length to zero, if the
+     * index is not less than the count.
+     *
+     * It is the responsibilty of the calling program to 'delete []' the proof once
+     * it has finished with it.
+     */
+    static uint8_t* generateProof(
+        Hash* digester,
+        const uint8_t* leaves,
+        const size_t count,
+        const size_t index,
+        size_t& length
+    );
+
+    /**
+     * This function is passed a leaf digest, its index, the total number of leaves,
+     * a proof and the root digest. It returns whether or not the proof shows that the
+     * leaf belongs to the Merkle tree with that root.
+     */
+    static bool validProof(
+        Hash* digester,
+        const uint8_t* leaf,
+        const size_t index,
+        const size_t count,
+        const uint8_t* proof,
+        const size_t length,
+        const uint8_t* root
+    );
+
+  private:
+    // These are private since this is a utility class with only static functions.
+    Merkle();
+   ~Merkle();
+};
+
+#endif
@@ -0,0 +1,168 @@
+/************************************************************************
+ * Copyright (c) Crater Dog Technologies(TM).  All Rights Reserved.     *
+ ************************************************************************
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.        *
+ *                                                                      *
+ * This source code is for reference purposes only.  It is protected by *
+ * US Patent 9,853,813 and any use of this source code will be deemed   *
+ * an infringement of the patent.  Crater Dog Technologies(TM) retains  *
+ * full ownership of this source code.  If you are interested in        *
+ * experimenting with, or licensing the technology, please contact us   *
+ * at craterdog@gmail.com                                               *
+ ************************************************************************/
+
+/*
+This example runs tests on the Merkle class to verify correct behaviour.
+*/
+
+#include <Crypto.h>
+#include <SHA256.h>
+#include <Merkle.h>
+#include <string.h>
+
+#define DIGEST_SIZE 32
+#define MAX_LEAVES 9
+
+// The root of the tree over the bytes 0x00..0x11 split into 4 byte chunks,
+// giving five leaves, computed independently of this implementation.
+static uint8_t const expectedRoot[DIGEST_SIZE] = {
+    0xE8, 0xF8, 0xB6, 0x08, 0x3C, 0x25, 0x83, 0x3A,
+    0x61, 0x31, 0x3A, 0xD3, 0x74, 0xA2, 0xDB, 0x6B,
+    0xFD, 0xD4, 0x2A, 0x94, 0x78, 0x86, 0x6A, 0x71,
+    0xEA, 0xCB, 0x1C, 0xBE, 0x95, 0xFF, 0xDD, 0x4D
+};
+
+SHA256 sha256;
+
+uint8_t bytes[MAX_LEAVES * 4];
+
+void report(bool ok)
+{
+    if (ok)
+        Serial.println("Passed");
+    else
+        Serial.println("Failed");
+}
+
+void testKnownRoot()
+{
+    size_t count;
+
+    Serial.print("Root of five leaves ... ");
+    for (size_t i = 0; i < 18; i++) bytes[i] = (uint8_t) i;
+    uint8_t* leaves = Merkle::digestLeaves(&sha256, bytes, 18, 4, count);
+    uint8_t* root = Merkle::digestRoot(&sha256, leaves, count);
+    report(count == 5 && memcmp(root, expectedRoot, DIGEST_SIZE) == 0);
+    delete [] root;
+    delete [] leaves;
+}
+
+void testSingleLeaf()
+{
+    size_t count;
+    size_t length;
+
+    Serial.print("Single leaf ... ");
+    uint8_t* leaves = Merkle::digestLeaves(&sha256, bytes, 3, 4, count);
+    uint8_t* root = Merkle::digestRoot(&sha256, leaves, count);
+    uint8_t* proof = Merkle::generateProof(&sha256, leaves, count, 0, length);
+    bool ok = count == 1 && length == 0 && memcmp(root, leaves, DIGEST_SIZE) == 0;
+    ok &= Merkle::validProof(&sha256, leaves, 0, count, proof, length, root);
+    report(ok);
+    delete [] proof;
+    delete [] root;
+    delete [] leaves;
+}
+
+// Generates and checks the proof of every leaf for trees with an even
+// and an odd number of leaves, including tampered proofs and leaves.
+void testProofs(size_t count)
+{
+    size_t length;
+    bool ok = true;
+
+    Serial.print("Proofs for ");
+    Serial.print(count);
+    Serial.print(" leaves ... ");
+    for (size_t i = 0; i < count * 4; i++) bytes[i] = (uint8_t) (i * 7);
+    size_t leafCount;
+    uint8_t* leaves = Merkle::digestLeaves(&sha256, bytes, count * 4, 4, leafCount);
+    uint8_t* root = Merkle::digestRoot(&sha256, leaves, count);
+    ok &= leafCount == count;
+    for (size_t index = 0; index < count; index++) {
+        const uint8_t* leaf = leaves + index * DIGEST_SIZE;
+        uint8_t* proof = Merkle::generateProof(&sha256, leaves, count, index, length);
+        ok &= Merkle::validProof(&sha256, leaf, index, count, proof, length, root);
+
+        // the proof must not validate the leaf at any other position
+        if (count > 1) {
+            size_t other = (index + 1) % count;
+            ok &= !Merkle::validProof(&sha256, leaf, other, count, proof, length, root);
+        }
+
+        // tampering with any sibling digest must invalidate the proof
+        for (size_t i = 0; i < length; i++) {
+            proof[i * DIGEST_SIZE] ^= 0x01;
+            ok &= !Merkle::validProof(&sha256, leaf, index, count, proof, length, root);
+            proof[i * DIGEST_SIZE] ^= 0x01;
+        }
+
+        // a truncated proof must be rejected
+        if (length > 0) {
+            ok &= !Merkle::validProof(&sha256, leaf, index, count, proof, length - 1, root);
+        }
+        delete [] proof;
+    }
+
+    // a tampered leaf must be rejected
+    leaves[0] ^= 0x80;
+    uint8_t* proof = Merkle::generateProof(&sha256, leaves, count, 0, length);
+    ok &= !Merkle::validProof(&sha256, leaves, 0, count, proof, length, root);
+    delete [] proof;
+
+    report(ok);
+    delete [] root;
+    delete [] leaves;
+}
+
+void testBadArguments()
+{
+    size_t count;
+    size_t length = 99;
+
+    Serial.print("Bad arguments ... ");
+    uint8_t* leaves = Merkle::digestLeaves(&sha256, bytes, 12, 4, count);
+    uint8_t* root = Merkle::digestRoot(&sha256, leaves, count);
+    size_t emptyCount = 99;
+    bool ok = Merkle::digestLeaves(&sha256, bytes, 12, 0, emptyCount) == 0;
+    ok &= emptyCount == 0;
+    ok &= Merkle::digestRoot(&sha256, leaves, 0) == 0;
+    ok &= Merkle::generateProof(&sha256, leaves, count, count, length) == 0;
+    ok &= length == 0;
+    ok &= Merkle::generateProof(&sha256, leaves, 0, 0, length) == 0;
+    uint8_t* proof = Merkle::generateProof(&sha256, leaves, count, 2, length);
+    ok &= !Merkle::validProof(&sha256, leaves + 2 * DIGEST_SIZE, count, count, proof, length, root);
+    report(ok);
+    delete [] proof;
+    delete [] root;
+    delete [] leaves;
+}
+
+void setup()
+{
+    Serial.begin(9600);
+
+    Serial.println();
+
+    Serial.println("Test Vectors:");
+    testKnownRoot();
+    testSingleLeaf();
+    for (size_t count = 2; count <= MAX_LEAVES; count++) {
+        testProofs(count);
+    }
+    testBadArguments();
+}
+
+void loop()
+{
+}